@@ -0,0 +1,319 @@
+/*
+Module Name : Column Cache
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Save a parsed CSV file as a binary column file so later runs can skip parsing the text
+
+Module Design Description
+The cache file starts with a fixed header (magic, format version, byte-order mark, row and
+column counts, and the size and modification time of the CSV it was built from), followed by
+one entry per column (type, number of levels, min, max, and where its values start), the CSV
+header line, and the levels of the categorical columns, one per line. The column names are
+split from the stored header line the same way readTypedCsv splits it, so a cached table has
+exactly the names of a parsed one. The values of every
+column are stored one after another in the column's own type (see TypedColumns.h), each column
+starting on a 64-byte boundary, so a cache of small integer columns is a fraction of the size
+of the doubles. The cache is memory-mapped when it is read, and readTypedCsvCached hands out
+the columns in place: the table's columns point straight into the mapping, which the table
+keeps open, so loading a cached file costs no copies at all. It is only used if the size and
+modification time of the CSV still match, otherwise the CSV is parsed again and the cache is
+rewritten. The cache is written under a temporary name that includes the process id and then
+renamed, so two processes building the same cache at once never write to the same file.
+*/
+
+#ifndef COLUMN_CACHE_H
+#define COLUMN_CACHE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+#include "CsvReader.h"
+#include "TypedColumns.h"
+
+const char CACHE_MAGIC[8] = { 'M', 'L', 'C', 'O', 'L', 'S', '\0', '\0' };
+const uint32_t CACHE_VERSION = 4;
+// written as a number so a cache made on a machine with the other byte order is rejected
+const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+const size_t CACHE_ALIGNMENT = 64;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    uint32_t numColumns;
+    // leading CSV columns that were skipped when the cache was built
+    uint32_t skipLeading;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t headerLineLength;
+    // bytes of the levels of all categorical columns, after the header line
+    uint64_t levelsLength;
+};
+
+struct CacheColumn {
+    // a ColumnType
+    uint32_t type;
+    // number of levels of a categorical column, 0 for a numeric one
+    uint32_t levels;
+    // byte offset of the first value from the start of the file
+    uint64_t offset;
+    double minValue;
+    double maxValue;
+};
+
+static_assert(sizeof(CacheHeader) == 64, "cache header layout changed");
+static_assert(sizeof(CacheColumn) == 32, "cache column layout changed");
+
+// default location of the cache for a CSV file
+inline std::string cachePathFor(const std::string& csvPath) {
+    return csvPath + ".cols";
+}
+
+// size and modification time of a file, used to tell whether a cache is stale
+inline bool sourceStamp(const std::string& path, uint64_t& size, int64_t& time) {
+    std::error_code ec;
+    size = (uint64_t)std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    time = (int64_t)std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+}
+
+// a temporary name next to path that no other process writing the same file uses
+inline std::string temporaryPathFor(const std::string& path) {
+#if defined(_WIN32)
+    return path + ".tmp" + std::to_string(_getpid());
+#else
+    return path + ".tmp" + std::to_string(getpid());
+#endif
+}
+
+inline size_t alignUp(size_t n) {
+    return (n + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+/* write the columns in table to a cache file for the CSV at csvPath
+ * the file is written under a temporary name and renamed so a reader never sees half a cache
+ */
+inline bool writeColumnCache(const std::string& cachePath, const std::string& csvPath, const TypedTable& table,
+    int skipLeading, std::string& error) {
+    std::string levels;
+    for (const TypedColumn& column : table.columns) {
+        for (const std::string& level : column.levels()) {
+            levels += level + '\n';
+        }
+    }
+
+    CacheHeader header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.rows = table.rows;
+    header.numColumns = (uint32_t)table.columns.size();
+    header.skipLeading = (uint32_t)skipLeading;
+    header.headerLineLength = table.headerLine.size();
+    header.levelsLength = levels.size();
+    if (!sourceStamp(csvPath, header.sourceSize, header.sourceTime)) {
+        error = "Could not read the size and time of " + csvPath;
+        return false;
+    }
+
+    // lay the columns out after the header, the column entries, the header line and the levels
+    size_t offset = alignUp(sizeof(CacheHeader) + table.columns.size() * sizeof(CacheColumn) + table.headerLine.size()
+        + levels.size());
+    std::vector<CacheColumn> entries(table.columns.size());
+    for (size_t c = 0; c < table.columns.size(); c++) {
+        const TypedColumn& column = table.columns[c];
+        CacheColumn& entry = entries[c];
+        memset(&entry, 0, sizeof(entry));
+        entry.type = column.type();
+        entry.levels = (uint32_t)column.levels().size();
+        entry.offset = offset;
+        entry.minValue = std::numeric_limits<double>::infinity();
+        entry.maxValue = -std::numeric_limits<double>::infinity();
+        column.visit([&](const auto* values) {
+            for (size_t i = 0; i < column.size(); i++) {
+                entry.minValue = std::min(entry.minValue, (double)values[i]);
+                entry.maxValue = std::max(entry.maxValue, (double)values[i]);
+            }
+        });
+        offset = alignUp(offset + column.bytes());
+    }
+
+    std::string tempPath = temporaryPathFor(cachePath);
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        error = "Could not create " + tempPath;
+        return false;
+    }
+
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(CacheColumn));
+    out.write(table.headerLine.data(), table.headerLine.size());
+    out.write(levels.data(), levels.size());
+
+    const char padding[CACHE_ALIGNMENT] = {};
+    for (size_t c = 0; c < table.columns.size(); c++) {
+        size_t position = (size_t)out.tellp();
+        out.write(padding, entries[c].offset - position);
+        out.write((const char*)table.columns[c].ref().values, table.columns[c].bytes());
+    }
+    out.close();
+    if (!out) {
+        error = "Could not write " + tempPath;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        error = "Could not rename " + tempPath + " to " + cachePath;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// a memory-mapped cache file; the columns point straight into the mapping
+class ColumnCache {
+public:
+    /* map the cache at cachePath if it is valid for the CSV at csvPath
+     * returns false if it is missing, from another format version, or stale
+     */
+    bool open(const std::string& cachePath, const std::string& csvPath, int skipLeading) {
+        if (!file.open(cachePath) || file.size() < sizeof(CacheHeader)) {
+            return false;
+        }
+        header = (const CacheHeader*)file.data();
+        if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->version != CACHE_VERSION ||
+            header->byteOrder != CACHE_BYTE_ORDER || header->skipLeading != (uint32_t)skipLeading) {
+            return false;
+        }
+
+        uint64_t size;
+        int64_t time;
+        if (!sourceStamp(csvPath, size, time) || size != header->sourceSize || time != header->sourceTime) {
+            return false;
+        }
+
+        // make sure every column lies inside the file before handing out pointers to it
+        size_t entriesEnd = sizeof(CacheHeader) + header->numColumns * sizeof(CacheColumn) + header->headerLineLength;
+        if (entriesEnd + header->levelsLength > file.size()) {
+            return false;
+        }
+        entries = (const CacheColumn*)(file.data() + sizeof(CacheHeader));
+        for (uint32_t c = 0; c < header->numColumns; c++) {
+            if (entries[c].type > COLUMN_UINT8 || entries[c].offset % CACHE_ALIGNMENT != 0 ||
+                entries[c].offset + header->rows * columnTypeSize((ColumnType)entries[c].type) > file.size()) {
+                return false;
+            }
+        }
+
+        // the levels of every categorical column, one per line
+        levelLists.assign(header->numColumns, std::vector<std::string>());
+        const char* level = file.data() + entriesEnd;
+        const char* levelsEnd = level + header->levelsLength;
+        for (uint32_t c = 0; c < header->numColumns; c++) {
+            for (uint32_t l = 0; l < entries[c].levels; l++) {
+                const char* newline = std::find(level, levelsEnd, '\n');
+                if (newline == levelsEnd) {
+                    return false;
+                }
+                levelLists[c].emplace_back(level, newline);
+                level = newline + 1;
+            }
+        }
+
+        // the names of the columns that were kept, from the full header line
+        std::vector<std::string> names = splitHeader(headerLine());
+        if (names.size() != header->skipLeading + header->numColumns) {
+            return false;
+        }
+        columnNames.assign(names.begin() + header->skipLeading, names.end());
+        return true;
+    }
+
+    size_t rows() const { return header->rows; }
+    size_t numColumns() const { return header->numColumns; }
+    const std::string& name(size_t c) const { return columnNames[c]; }
+    double minValue(size_t c) const { return entries[c].minValue; }
+    double maxValue(size_t c) const { return entries[c].maxValue; }
+
+    std::string headerLine() const {
+        const char* line = file.data() + sizeof(CacheHeader) + header->numColumns * sizeof(CacheColumn);
+        return std::string(line, header->headerLineLength);
+    }
+
+    // values of column c, valid as long as the cache is open
+    ColumnRef column(size_t c) const {
+        return ColumnRef((ColumnType)entries[c].type, file.data() + entries[c].offset, header->rows);
+    }
+
+    // the levels of a categorical column; empty for a numeric one
+    const std::vector<std::string>& levels(size_t c) const { return levelLists[c]; }
+
+    // column c read in place, valid as long as the cache is open
+    TypedColumn typedColumn(size_t c) const {
+        return TypedColumn::inPlace(column(c), entries[c].levels > 0 ? &levelLists[c] : nullptr);
+    }
+
+private:
+    MappedFile file;
+    std::vector<std::vector<std::string>> levelLists;
+    std::vector<std::string> columnNames;
+    const CacheHeader* header = nullptr;
+    const CacheColumn* entries = nullptr;
+};
+
+/* read a CSV file into typed columns (see readTypedCsv), going through its column cache
+ * the columns of a fresh cache are read in place from the mapping, which the table keeps open;
+ * otherwise the CSV is parsed and the cache is rebuilt for the next run. fromCache tells which
+ * one happened.
+ */
+inline bool readTypedCsvCached(const std::string& csvPath, TypedTable& table, int skipLeading, int threads, bool& fromCache) {
+    std::string cachePath = cachePathFor(csvPath);
+    std::shared_ptr<ColumnCache> cache = std::make_shared<ColumnCache>();
+    fromCache = cache->open(cachePath, csvPath, skipLeading);
+
+    if (fromCache) {
+        table.headerLine = cache->headerLine();
+        table.rows = cache->rows();
+        table.header.clear();
+        table.columns.clear();
+        for (size_t c = 0; c < cache->numColumns(); c++) {
+            table.header.push_back(cache->name(c));
+            table.columns.push_back(cache->typedColumn(c));
+        }
+        table.storage = cache;
+        return true;
+    }
+
+    if (!readTypedCsv(csvPath, table, skipLeading, threads)) {
+        return false;
+    }
+
+    // failing to write the cache only costs the next run its head start
+    std::string error;
+    writeColumnCache(cachePath, csvPath, table, skipLeading, error);
+    return true;
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*
+Module Name : Correlation Matrix
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Compute the covariance or correlation between every pair of columns of a table at once
+
+Module Design Description
+The means come from one pass of RunningStats over every column. The rows are then cut into
+blocks of ROW_BLOCK rows and every thread takes a contiguous range of blocks. For each block
+the thread copies the centered values of all columns into a small scratch buffer that stays
+in cache, and adds that block's contribution to its own p x p sum of products using a 4x4
+kernel (AVX2/FMA when the compiler targets it). The per-thread sums are added up in thread
+order at the end and divided by n - 1, so the data is read from memory twice in total
+instead of once per pair. Only the upper triangle is computed; the lower one is mirrored.
+*/
+
+#ifndef CORRELATION_MATRIX_H
+#define CORRELATION_MATRIX_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "StreamingStats.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// rows per block; 512 rows of a few hundred columns fit in the L2 cache
+const size_t ROW_BLOCK = 512;
+
+// a square matrix of pairwise statistics between named columns
+struct PairMatrix {
+    std::vector<std::string> names;
+    // row-major p x p values
+    std::vector<double> values;
+
+    size_t size() const { return names.size(); }
+    double at(size_t i, size_t j) const { return values[i * names.size() + j]; }
+};
+
+/* add the products of 4 columns of a with 4 columns of b over len rows into sums
+ * a and b point at the first of 4 consecutive centered columns in the scratch block
+ * stride = distance between consecutive columns, out = sum matrix, p = its width
+ */
+inline void productKernel4x4(const double* a, const double* b, size_t len, size_t stride, double* out, size_t p) {
+    double acc[4][4] = {};
+    size_t r = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256d sums[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            sums[i][j] = _mm256_setzero_pd();
+        }
+    }
+    for (; r + 4 <= len; r += 4) {
+        __m256d bv[4];
+        for (int j = 0; j < 4; j++) {
+            bv[j] = _mm256_loadu_pd(b + j * stride + r);
+        }
+        for (int i = 0; i < 4; i++) {
+            __m256d av = _mm256_loadu_pd(a + i * stride + r);
+            for (int j = 0; j < 4; j++) {
+                sums[i][j] = _mm256_fmadd_pd(av, bv[j], sums[i][j]);
+            }
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            double lanes[4];
+            _mm256_storeu_pd(lanes, sums[i][j]);
+            acc[i][j] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+    }
+#endif
+    for (; r < len; r++) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                acc[i][j] += a[i * stride + r] * b[j * stride + r];
+            }
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            out[i * p + j] += acc[i][j];
+        }
+    }
+}
+
+/* compute the sample covariance matrix of the columns
+ * names = column names, threads = number of threads to split the rows across
+ */
+inline PairMatrix covarianceMatrix(const std::vector<std::vector<double>>& columns, const std::vector<std::string>& names,
+    int threads = 1) {
+    size_t p = columns.size();
+    size_t n = p == 0 ? 0 : columns[0].size();
+
+    PairMatrix result;
+    result.names = names;
+    result.values.assign(p * p, 0);
+    if (n < 2) {
+        return result;
+    }
+
+    // first pass: the mean of every column
+    std::vector<double> means(p);
+    for (size_t c = 0; c < p; c++) {
+        means[c] = collectStats(columns[c], threads).mean();
+    }
+
+    // pad the number of columns to a multiple of 4 with zero columns so the kernel needs no edge case
+    size_t padded = (p + 3) / 4 * 4;
+    size_t blocks = (n + ROW_BLOCK - 1) / ROW_BLOCK;
+    size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), blocks));
+
+    std::vector<std::vector<double>> partial(workers, std::vector<double>(padded * padded, 0));
+    std::vector<std::thread> pool;
+
+    for (size_t w = 0; w < workers; w++) {
+        auto work = [&, w]() {
+            std::vector<double> scratch(padded * ROW_BLOCK, 0);
+            std::vector<double>& sums = partial[w];
+
+            for (size_t block = blocks * w / workers; block < blocks * (w + 1) / workers; block++) {
+                size_t r0 = block * ROW_BLOCK;
+                size_t len = std::min(ROW_BLOCK, n - r0);
+
+                // second pass: center this block of every column once into the scratch buffer
+                for (size_t c = 0; c < p; c++) {
+                    const double* src = columns[c].data() + r0;
+                    double* dst = scratch.data() + c * ROW_BLOCK;
+                    for (size_t r = 0; r < len; r++) {
+                        dst[r] = src[r] - means[c];
+                    }
+                }
+
+                // upper triangle of 4x4 tiles
+                for (size_t i = 0; i < padded; i += 4) {
+                    for (size_t j = i; j < padded; j += 4) {
+                        productKernel4x4(scratch.data() + i * ROW_BLOCK, scratch.data() + j * ROW_BLOCK, len, ROW_BLOCK,
+                            sums.data() + i * padded + j, padded);
+                    }
+                }
+            }
+        };
+        if (workers == 1) {
+            work();
+        }
+        else {
+            pool.emplace_back(work);
+        }
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    // add the per-thread sums in a fixed order and mirror the upper triangle
+    for (size_t i = 0; i < p; i++) {
+        for (size_t j = i; j < p; j++) {
+            double total = 0;
+            for (size_t w = 0; w < workers; w++) {
+                total += partial[w][i * padded + j];
+            }
+            result.values[i * p + j] = total / (n - 1);
+            result.values[j * p + i] = total / (n - 1);
+        }
+    }
+    return result;
+}
+
+// turn a covariance matrix into a correlation matrix
+inline PairMatrix correlationMatrix(const PairMatrix& covariance) {
+    PairMatrix result = covariance;
+    size_t p = covariance.size();
+    for (size_t i = 0; i < p; i++) {
+        for (size_t j = 0; j < p; j++) {
+            result.values[i * p + j] = covariance.at(i, j) / std::sqrt(covariance.at(i, i) * covariance.at(j, j));
+        }
+    }
+    return result;
+}
+
+// write the matrix as CSV with the column names as the header and first column
+inline bool writeMatrixCsv(const PairMatrix& matrix, std::ostream& out) {
+    out.precision(17);
+    for (size_t j = 0; j < matrix.size(); j++) {
+        out << "," << matrix.names[j];
+    }
+    out << "\n";
+    for (size_t i = 0; i < matrix.size(); i++) {
+        out << matrix.names[i];
+        for (size_t j = 0; j < matrix.size(); j++) {
+            out << "," << matrix.at(i, j);
+        }
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+/* write the matrix in binary: the magic "MLPAIRS", a uint32 version and a uint32 size p,
+ * then each name as a uint32 length and its bytes, then the p x p doubles in row-major order
+ */
+inline bool writeMatrixBinary(const PairMatrix& matrix, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    const char magic[8] = { 'M', 'L', 'P', 'A', 'I', 'R', 'S', '\0' };
+    uint32_t version = 1;
+    uint32_t p = (uint32_t)matrix.size();
+    out.write(magic, sizeof(magic));
+    out.write((const char*)&version, sizeof(version));
+    out.write((const char*)&p, sizeof(p));
+    for (const std::string& name : matrix.names) {
+        uint32_t length = (uint32_t)name.size();
+        out.write((const char*)&length, sizeof(length));
+        out.write(name.data(), length);
+    }
+    out.write((const char*)matrix.values.data(), matrix.values.size() * sizeof(double));
+    return (bool)out;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/*
+Module Name : Cross Validation
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Estimate how well a model does on data it was not trained on by k-fold cross-validation, and
+compare a grid of solver settings with it, using every core
+
+Module Design Description
+makeFolds shuffles the row numbers once and deals them out to k folds in turn; with
+stratified set the rows of each class are dealt out separately so every fold has about the
+same share of positives. splitRows makes a single train/test split the same way, picking the
+test rows evenly along the shuffled (and, if stratified, class-sorted) order. A fold only
+holds row numbers: its training and test rows are RowViews of the one data matrix (the fold's
+row numbers are looked up through the view being cross-validated, so a fold of a shuffled
+split is still a view of the loaded data), so k folds of a grid of settings never copy the
+features (only the labels of a fold are gathered into a Vector, which the solvers take).
+crossValidate makes one task per (setting, fold) pair and runs them on a ThreadPool; the pool
+hands out the tasks one at a time through an atomic counter, so a thread that finishes a
+cheap task (a Newton fit) takes the next one instead of waiting on a slow one (gradient
+descent). Each task trains with one thread and writes its accuracy and log-loss to its own
+slot, and the slots are added up into a RunningStats per setting in fold order, so the
+results do not depend on the number of threads. The scores come from evaluateMetrics in
+Metrics.h, and makeFolds does not depend on the model, so it is shared with the naive Bayes
+program.
+*/
+
+#ifndef CROSS_VALIDATION_H
+#define CROSS_VALIDATION_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include "Matrix.h"
+#include "LogisticKernels.h"
+#include "LogisticSolvers.h"
+#include "StreamingStats.h"
+#include "ThreadPool.h"
+#include "Metrics.h"
+
+// the rows one fold trains and tests on
+struct Fold {
+    std::vector<size_t> train;
+    std::vector<size_t> test;
+};
+
+/* split the rows 0..n-1 into k folds, shuffled with seed
+ * labels (0 or 1, one per row, of any numeric type) are only used when stratified is set, to keep
+ * the classes balanced; the rows of every fold are in increasing order, so reading them walks the
+ * matrix forwards
+ */
+template <typename Label>
+std::vector<Fold> makeFolds(const Label* labels, size_t n, int k, bool stratified, unsigned long seed) {
+    k = std::max(k, 2);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), (size_t)0);
+    std::mt19937_64 random(seed);
+    std::shuffle(order.begin(), order.end(), random);
+    if (stratified) {
+        // all the negatives first, then all the positives, each still shuffled
+        std::stable_partition(order.begin(), order.end(), [&](size_t i) { return labels[i] == 0; });
+    }
+
+    // row order[r] goes to the test rows of fold r % k
+    std::vector<int> foldOf(n);
+    for (size_t r = 0; r < n; r++) {
+        foldOf[order[r]] = (int)(r % k);
+    }
+    std::vector<Fold> folds(k);
+    for (size_t i = 0; i < n; i++) {
+        for (int f = 0; f < k; f++) {
+            (foldOf[i] == f ? folds[f].test : folds[f].train).push_back(i);
+        }
+    }
+    return folds;
+}
+
+/* split the rows 0..n-1 into testRows test rows and the rest to train on, shuffled with seed
+ * labels (0 or 1, one per row, of any numeric type) are only used when stratified is set, to give
+ * both classes the same share of test rows; both lists are in increasing order
+ */
+template <typename Label>
+Fold splitRows(const Label* labels, size_t n, size_t testRows, bool stratified, unsigned long seed) {
+    testRows = std::min(testRows, n);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), (size_t)0);
+    std::mt19937_64 random(seed);
+    std::shuffle(order.begin(), order.end(), random);
+    if (stratified) {
+        std::stable_partition(order.begin(), order.end(), [&](size_t i) { return labels[i] == 0; });
+    }
+
+    // row order[r] is a test row if the count of test rows up to it goes up there
+    std::vector<char> isTest(n);
+    for (size_t r = 0; r < n; r++) {
+        isTest[order[r]] = (r + 1) * testRows / n > r * testRows / n;
+    }
+    Fold split;
+    split.test.reserve(testRows);
+    split.train.reserve(n - testRows);
+    for (size_t i = 0; i < n; i++) {
+        (isTest[i] ? split.test : split.train).push_back(i);
+    }
+    return split;
+}
+
+// one combination of settings to cross-validate
+struct GridPoint {
+    std::string solver;
+    SolverOptions options;
+};
+
+// the scores of one grid point over the folds
+struct CvResult {
+    GridPoint point;
+    RunningStats accuracy;
+    RunningStats logLoss;
+};
+
+// the labels of the given rows
+inline Vector gatherLabels(const Vector& y, const std::vector<size_t>& rows) {
+    Vector gathered(rows.size());
+    for (size_t r = 0; r < rows.size(); r++) {
+        gathered[r] = y[rows[r]];
+    }
+    return gathered;
+}
+
+// the labels of the rows of x, where y holds one label per row of the matrix under it
+inline Vector gatherLabels(const Vector& y, const RowView& x) {
+    Vector gathered(x.rows());
+    for (size_t r = 0; r < x.rows(); r++) {
+        gathered[r] = y[x.row(r)];
+    }
+    return gathered;
+}
+
+// the rows of the matrix under x that the given rows of x are
+inline std::vector<size_t> viewRows(const RowView& x, const std::vector<size_t>& rows) {
+    std::vector<size_t> viewed(rows.size());
+    for (size_t r = 0; r < rows.size(); r++) {
+        viewed[r] = x.row(rows[r]);
+    }
+    return viewed;
+}
+
+/* train every grid point on every fold of x (one row per observation) and y (labels 0 or 1)
+ * with threads threads; the grid points' solver names must be known to findSolver
+ * returns one result per grid point, in grid order
+ */
+inline std::vector<CvResult> crossValidate(const RowView& x, const Vector& y, const std::vector<Fold>& folds,
+    const std::vector<GridPoint>& grid, int threads) {
+    size_t numFolds = folds.size();
+    std::vector<Vector> trainLabels;
+    std::vector<Vector> testLabels;
+    std::vector<std::vector<size_t>> trainRows;
+    std::vector<std::vector<size_t>> testRows;
+    for (const Fold& fold : folds) {
+        trainLabels.push_back(gatherLabels(y, fold.train));
+        testLabels.push_back(gatherLabels(y, fold.test));
+        trainRows.push_back(viewRows(x, fold.train));
+        testRows.push_back(viewRows(x, fold.test));
+    }
+
+    // task t = grid point t / numFolds on fold t % numFolds
+    std::vector<double> accuracy(grid.size() * numFolds);
+    std::vector<double> logLoss(grid.size() * numFolds);
+    ThreadPool pool(threads);
+    pool.run(grid.size() * numFolds, [&](size_t t) {
+        const GridPoint& point = grid[t / numFolds];
+        size_t f = t % numFolds;
+        RowView train(x.matrix(), trainRows[f].data(), trainRows[f].size(), x.hasIntercept());
+        RowView test(x.matrix(), testRows[f].data(), testRows[f].size(), x.hasIntercept());
+
+        // the pool already keeps every thread busy, so each fit runs on one
+        SolverOptions options = point.options;
+        options.threads = 1;
+        SolverResult fit = findSolver<RowView>(point.solver)(train, trainLabels[f], options);
+
+        std::vector<double> probs(test.rows());
+        logisticPredict(test, fit.weights, probs.data(), options.sigmoidMode);
+        BinaryMetrics metrics = evaluateMetrics(probs.data(), testLabels[f].data(), probs.size());
+        accuracy[t] = metrics.accuracy();
+        logLoss[t] = metrics.logLoss();
+    });
+
+    std::vector<CvResult> results(grid.size());
+    for (size_t g = 0; g < grid.size(); g++) {
+        results[g].point = grid[g];
+        for (size_t f = 0; f < numFolds; f++) {
+            results[g].accuracy.add(accuracy[g * numFolds + f]);
+            results[g].logLoss.add(logLoss[g * numFolds + f]);
+        }
+    }
+    return results;
+}
+
+#endif
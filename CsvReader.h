@@ -0,0 +1,388 @@
+/*
+Module Name : CSV Reader
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Read a numeric CSV file into columns quickly and without a limit on the number of rows
+
+Module Design Description
+The file is memory-mapped and scanned 64 bytes at a time for commas and newlines (with AVX2 or
+SSE2 when the compiler targets them, otherwise byte by byte). Each field is parsed in place with
+from_chars, so no strings are allocated, and the values are appended to growable columns.
+The first line is the header. Leading columns such as a row id can be skipped without being
+parsed. Quotes around a field are ignored, but a quoted field may not contain a comma.
+Large files can be read on several threads: the rows are split into byte ranges that start
+right after a newline, each range is parsed into its own columns, and the pieces are joined
+in file order, so the result is the same as reading the file on one thread. splitList cuts
+the comma-separated lists the programs take on the command line the same way.
+*/
+
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include "MappedFile.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// the columns read from a CSV file
+struct CsvTable {
+    // the first line of the file as it was read
+    std::string headerLine;
+    // names of the columns that were read (skipped columns are not included)
+    std::vector<std::string> header;
+    std::vector<std::vector<double>> columns;
+    size_t rows = 0;
+    // what went wrong when reading failed
+    std::string error;
+};
+
+// finds the commas and newlines in a 64-byte block; bit i is set if p[i] is a delimiter
+inline uint64_t delimiterMask(const char* p, const char* end) {
+    uint64_t mask = 0;
+    if (end - p >= 64) {
+#if defined(__AVX2__)
+        const __m256i comma = _mm256_set1_epi8(',');
+        const __m256i newline = _mm256_set1_epi8('\n');
+        for (int i = 0; i < 64; i += 32) {
+            __m256i block = _mm256_loadu_si256((const __m256i*)(p + i));
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, comma), _mm256_cmpeq_epi8(block, newline));
+            mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hits) << i;
+        }
+        return mask;
+#elif defined(__SSE2__)
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (int i = 0; i < 64; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline));
+            mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(hits) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // scalar scan for the tail of the file (or when no SIMD is available)
+    int n = end - p < 64 ? (int)(end - p) : 64;
+    for (int i = 0; i < n; i++) {
+        if (p[i] == ',' || p[i] == '\n') {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+    return mask;
+}
+
+// index of the lowest set bit of a non-zero mask
+inline int lowestBit(uint64_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+// walks through a byte range returning one delimiter position at a time
+class DelimiterScanner {
+public:
+    DelimiterScanner(const char* begin, const char* end) : block(begin), end(end) {
+        mask = block < end ? delimiterMask(block, end) : 0;
+    }
+
+    // position of the next comma or newline, or end if there are none left
+    const char* next() {
+        while (mask == 0) {
+            block += 64;
+            if (block >= end) {
+                return end;
+            }
+            mask = delimiterMask(block, end);
+        }
+        const char* pos = block + lowestBit(mask);
+        // clear the bit that was just returned
+        mask &= mask - 1;
+        return pos;
+    }
+
+private:
+    const char* block;
+    const char* end;
+    uint64_t mask;
+};
+
+// parse the number in [begin, end), ignoring surrounding quotes, spaces and a trailing '\r'
+inline bool parseField(const char* begin, const char* end, double& value) {
+    while (begin < end && (*begin == ' ' || *begin == '"')) {
+        begin++;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) {
+        end--;
+    }
+    // from_chars does not accept a leading '+'
+    if (begin < end && *begin == '+') {
+        begin++;
+    }
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end && begin < end;
+}
+
+// split the header line into column names, stripping quotes and a trailing '\r'
+inline std::vector<std::string> splitHeader(const std::string& line) {
+    std::vector<std::string> names;
+    std::string name;
+    for (char c : line) {
+        if (c == ',') {
+            names.push_back(name);
+            name.clear();
+        }
+        else if (c != '"' && c != '\r') {
+            name += c;
+        }
+    }
+    names.push_back(name);
+    return names;
+}
+
+// the non-empty comma-separated items of a list such as "newton,lbfgs" given on the command line
+inline std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = std::min(list.find(',', begin), list.size());
+        if (end > begin) {
+            items.push_back(list.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return items;
+}
+
+/* walk every row in [begin, end) and call store(column, fieldBegin, fieldEnd, line) for every
+ * field that is not skipped (column counts from the first field that is read)
+ * numFields = number of fields in every row, skipLeading = fields at the start of a row to ignore
+ * firstLine = line number of the first row, only used in error messages
+ * returns false and sets error if a row is short or long, or store returns false (store sets error)
+ */
+template <typename Store>
+bool scanCsvRange(const char* begin, const char* end, int numFields, int skipLeading, size_t firstLine,
+    std::string& error, Store store) {
+    DelimiterScanner scanner(begin, end);
+    const char* fieldStart = begin;
+    size_t line = firstLine;
+
+    while (fieldStart < end) {
+        // skip blank lines (including the trailing newline at the end of the file)
+        if (*fieldStart == '\n' || (*fieldStart == '\r' && fieldStart + 1 < end && fieldStart[1] == '\n')) {
+            const char* newline = *fieldStart == '\n' ? fieldStart : fieldStart + 1;
+            // move the scanner past the newline that ends the blank line
+            while (scanner.next() < newline) {
+            }
+            fieldStart = newline + 1;
+            line++;
+            continue;
+        }
+
+        for (int field = 0; field < numFields; field++) {
+            const char* delim = scanner.next();
+            bool lastField = field == numFields - 1;
+
+            // every field but the last has to end with a comma; the last ends the line
+            if (!lastField && (delim == end || *delim != ',')) {
+                error = "Line " + std::to_string(line) + " has fewer than " + std::to_string(numFields) + " fields";
+                return false;
+            }
+            if (lastField && delim != end && *delim != '\n') {
+                error = "Line " + std::to_string(line) + " has more than " + std::to_string(numFields) + " fields";
+                return false;
+            }
+
+            if (field >= skipLeading && !store(field - skipLeading, fieldStart, delim, line)) {
+                return false;
+            }
+
+            fieldStart = delim == end ? end : delim + 1;
+        }
+        line++;
+    }
+
+    return true;
+}
+
+/* parse every row in [begin, end) and append its values to columns
+ * numFields = number of fields in every row, skipLeading = fields at the start of a row to ignore
+ * firstLine = line number of the first row, only used in error messages
+ * returns false and sets error if a row is short or a field is not a number
+ */
+inline bool parseCsvRange(const char* begin, const char* end, int numFields, int skipLeading,
+    std::vector<std::vector<double>>& columns, size_t firstLine, std::string& error) {
+    return scanCsvRange(begin, end, numFields, skipLeading, firstLine, error,
+        [&](int column, const char* fieldBegin, const char* fieldEnd, size_t line) {
+            double value;
+            if (!parseField(fieldBegin, fieldEnd, value)) {
+                error = "Line " + std::to_string(line) + ": '" + std::string(fieldBegin, fieldEnd) + "' is not a number";
+                return false;
+            }
+            columns[column].push_back(value);
+            return true;
+        });
+}
+
+// smallest byte range worth parsing on its own thread
+const size_t MIN_CSV_CHUNK = 1 << 20;
+
+/* cut the rows in [body, end) into at most threads byte ranges for parsing in parallel
+ * range c is [cuts[c], cuts[c + 1]); every cut is moved forward to just past a newline so every
+ * range holds whole rows
+ */
+inline std::vector<const char*> csvChunkCuts(const char* body, const char* end, int threads) {
+    size_t length = (size_t)(end - body);
+    int chunks = (int)std::max((size_t)1, std::min((size_t)std::max(threads, 1), length / MIN_CSV_CHUNK));
+    std::vector<const char*> cuts(chunks + 1);
+    cuts[0] = body;
+    cuts[chunks] = end;
+    for (int c = 1; c < chunks; c++) {
+        const char* cut = std::max(body + length * c / chunks, cuts[c - 1]);
+        const void* newline = memchr(cut, '\n', (size_t)(end - cut));
+        cuts[c] = newline == nullptr ? end : (const char*)newline + 1;
+    }
+    return cuts;
+}
+
+// the line number of the row starting at cut (the header is line 1)
+inline size_t csvLineAt(const char* body, const char* cut) {
+    return 2 + (size_t)std::count(body, cut, '\n');
+}
+
+/* parse the rows in [body, end) on several threads and append them to columns in file order
+ * the ranges are cut right after a newline so every thread sees whole rows
+ */
+inline bool parseCsvParallel(const char* body, const char* end, int numFields, int skipLeading,
+    std::vector<std::vector<double>>& columns, int threads, std::string& error) {
+    std::vector<const char*> cuts = csvChunkCuts(body, end, threads);
+    int chunks = (int)cuts.size() - 1;
+    if (chunks <= 1) {
+        return parseCsvRange(body, end, numFields, skipLeading, columns, 2, error);
+    }
+
+    // parse every range into its own set of columns
+    std::vector<std::vector<std::vector<double>>> partial(chunks, std::vector<std::vector<double>>(columns.size()));
+    std::vector<std::string> errors(chunks);
+    std::vector<char> ok(chunks, 1);
+    std::vector<std::thread> workers;
+    for (int c = 0; c < chunks; c++) {
+        workers.emplace_back([&, c]() {
+            for (std::vector<double>& column : partial[c]) {
+                column.reserve((size_t)(cuts[c + 1] - cuts[c]) / (4 * numFields) + 1);
+            }
+            ok[c] = parseCsvRange(cuts[c], cuts[c + 1], numFields, skipLeading, partial[c], 0, errors[c]);
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    for (int c = 0; c < chunks; c++) {
+        if (!ok[c]) {
+            // parse the range again knowing its first line number so the error points at the right line
+            size_t firstLine = csvLineAt(body, cuts[c]);
+            std::vector<std::vector<double>> scratch(columns.size());
+            parseCsvRange(cuts[c], cuts[c + 1], numFields, skipLeading, scratch, firstLine, error);
+            return false;
+        }
+    }
+
+    // join the pieces in file order, each thread copying its own piece into place
+    std::vector<size_t> offsets(chunks + 1, 0);
+    for (int c = 0; c < chunks; c++) {
+        offsets[c + 1] = offsets[c] + partial[c][0].size();
+    }
+    size_t start = columns[0].size();
+    for (std::vector<double>& column : columns) {
+        column.resize(start + offsets[chunks]);
+    }
+
+    workers.clear();
+    for (int c = 0; c < chunks; c++) {
+        workers.emplace_back([&, c]() {
+            for (size_t col = 0; col < columns.size(); col++) {
+                std::copy(partial[c][col].begin(), partial[c][col].end(), columns[col].begin() + start + offsets[c]);
+                std::vector<double>().swap(partial[c][col]);
+            }
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    return true;
+}
+
+// read the first line of the file in [begin, end) into headerLine and return where the rows start
+inline const char* readCsvHeader(const char* begin, const char* end, std::string& headerLine) {
+    const char* headerEnd = begin;
+    while (headerEnd < end && *headerEnd != '\n') {
+        headerEnd++;
+    }
+    headerLine.assign(begin, headerEnd);
+    if (!headerLine.empty() && headerLine.back() == '\r') {
+        headerLine.pop_back();
+    }
+    return headerEnd < end ? headerEnd + 1 : end;
+}
+
+/* read the CSV file at path into table
+ * skipLeading = number of columns at the start of every row to ignore (for example a row id)
+ * threads = number of threads to parse with; small files are always read on one thread
+ * returns false and sets table.error if the file could not be opened or parsed
+ */
+inline bool readCsv(const std::string& path, CsvTable& table, int skipLeading = 0, int threads = 1) {
+    MappedFile file;
+    if (!file.open(path)) {
+        table.error = "Could not open file " + path + ".";
+        return false;
+    }
+
+    const char* end = file.data() + file.size();
+    const char* body = readCsvHeader(file.data(), end, table.headerLine);
+    std::vector<std::string> names = splitHeader(table.headerLine);
+    int numFields = (int)names.size();
+    if (skipLeading >= numFields) {
+        table.error = "File " + path + " has no columns to read";
+        return false;
+    }
+    table.header.assign(names.begin() + skipLeading, names.end());
+    table.columns.assign(numFields - skipLeading, std::vector<double>());
+
+    // guess the number of rows from the length of the first one so the columns rarely regrow
+    // (not needed when reading in parallel since the pieces are joined into exact-size columns)
+    if (threads <= 1 || (size_t)(end - body) < 2 * MIN_CSV_CHUNK) {
+        const char* firstRowEnd = body;
+        while (firstRowEnd < end && *firstRowEnd != '\n') {
+            firstRowEnd++;
+        }
+        size_t rowLength = (size_t)(firstRowEnd - body) + 1;
+        for (std::vector<double>& column : table.columns) {
+            column.reserve((size_t)(end - body) / rowLength + 1);
+        }
+    }
+
+    if (!parseCsvParallel(body, end, numFields, skipLeading, table.columns, threads, table.error)) {
+        return false;
+    }
+    table.rows = table.columns[0].size();
+    return true;
+}
+
+#endif
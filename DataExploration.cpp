@@ -16,151 +16,272 @@ Outputs:
 Display the results of calling the statistical functions
 */
 
-#include <fstream>
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cmath>
+#include <thread>
+#include "CsvReader.h"
+#include "Reduction.h"
+#include "StreamingStats.h"
+#include "QuantileSketch.h"
+#include "CorrelationMatrix.h"
+#include "GroupBy.h"
 
 using namespace std;
 
 // Find the sum of a numeric vector
-double sum(vector<double> v) {
-    double sum = 0;
-    // add every value in v to the sum
-    for (double n : v) {
-        sum += n;
-    }
-
-    return sum;
+double sum(const vector<double>& v) {
+    // compensated SIMD sum; the same answer for any thread count
+    return reduceSum(v);
 }
 
 // Find the mean of a numeric vector
-double mean(vector<double> v) {
-    return sum(v) / v.size();
+double mean(const vector<double>& v) {
+    return reduceMean(v);
 }
 
 // Find the median of a numeric vector
 double median(vector<double> v) {
-    // sort the vector
-    sort(v.begin(), v.end());
+    // select the middle value in O(n) instead of sorting the whole vector
+    auto mid = v.begin() + v.size() / 2;
+    nth_element(v.begin(), mid, v.end());
 
     // if the vector is of even length then median=average of middle two values
+    // after the selection the lower middle value is the largest one in front of mid
     if (v.size() % 2 == 0) {
-        double median = (v[v.size() / 2] + v[(v.size() / 2) - 1]) / 2;
+        double median = (*mid + *max_element(v.begin(), mid)) / 2;
         return median;
     }
     else {
-        return v[v.size() / 2];
+        return *mid;
     }
 }
 
 // Find the range of a numeric vector
-double range(vector<double> v) {
-    // sort the vector to be able to find the max and min values to compute the range
-    sort(v.begin(), v.end());
-    return v[v.size() - 1] - v[0];
+double range(const vector<double>& v) {
+    // the min and max are tracked while scanning so no sort is needed
+    return collectStats(v).range();
 }
 
 // Compute the covarriance between two numeric vectors
-double covar(vector<double> rm, vector<double> medv) {
-    double sum = 0;
-    double rm_mean = mean(rm);
-    double medv_mean = mean(medv);
-
-    for (int i = 0; i < rm.size(); i++) {
-        sum += (rm[i] - rm_mean) * (medv[i] - medv_mean);
-    }
-
-    return sum / (rm.size() - 1);
+double covar(const vector<double>& rm, const vector<double>& medv) {
+    return collectPairStats(rm, medv).covariance();
 }
 
 // Compute the correlation between two numeric vectors
-double cor(vector<double> rm, vector<double> medv) {
-    double sum = 0;
-    double rm_mean = mean(rm);
-    double medv_mean = mean(medv);
+double cor(const vector<double>& rm, const vector<double>& medv) {
+    // the means, sigmas and co-moment all come out of the same scan
+    return collectPairStats(rm, medv).correlation();
+}
+
+// Print out the basic stats about the vector, including its sum, mean, median, and range
+// sketch_k > 0 also prints the approximate quantiles from a KLL sketch with that accuracy
+void print_stats(const vector<double>& v, int threads, int sketch_k) {
+    // sum, mean, and range are computed in a single pass over the vector
+    RunningStats stats = collectStats(v, threads);
+
+    cout << "Sum = " << stats.sum() << endl;
+    cout << "Mean = " << stats.mean() << endl;
+    cout << "Median = " << median(v) << endl;
+    cout << "Range = " << stats.range() << endl;
 
-    // compute a part of the variance of rm
-    for (double num : rm) {
-        sum += (num - rm_mean) * (num - rm_mean);
+    if (sketch_k > 0) {
+        KllSketch sketch = collectSketch(v, sketch_k, threads);
+        cout << "Approx. median = " << sketch.quantile(0.5) << endl;
+        cout << "Approx. p90 = " << sketch.quantile(0.9) << endl;
+        cout << "Approx. p99 = " << sketch.quantile(0.99) << endl;
     }
-    // can now find sigma by taking the square root of the variance
-    double rm_sigma = sqrt(sum / (rm.size() - 1));
+}
 
-    sum = 0;
-    for (double num : medv) {
-        sum += (num - medv_mean) * (num - medv_mean);
+/* compute the covariance (kind = "cov") or correlation (kind = "cor") of every pair of columns
+ * and write it to out_path as CSV, or as binary if the path ends in .bin (stdout if it is empty)
+ */
+int write_matrix(const CsvTable& table, const string& kind, const string& out_path, int threads) {
+    if (kind != "cov" && kind != "cor") {
+        cout << "Unknown matrix kind " << kind << "; use cov or cor" << endl;
+        return 1;
     }
-    double medv_sigma = sqrt(sum / (medv.size() - 1));
 
-    // find the product of the sigmas
-    double sigma_prod = rm_sigma * medv_sigma;
+    PairMatrix matrix = covarianceMatrix(table.columns, table.header, threads);
+    if (kind == "cor") {
+        matrix = correlationMatrix(matrix);
+    }
 
-    return covar(rm, medv) / sigma_prod;
+    bool written;
+    if (out_path.empty()) {
+        written = writeMatrixCsv(matrix, cout);
+    }
+    else if (out_path.size() > 4 && out_path.substr(out_path.size() - 4) == ".bin") {
+        written = writeMatrixBinary(matrix, out_path);
+    }
+    else {
+        ofstream outFS(out_path);
+        written = outFS.is_open() && writeMatrixCsv(matrix, outFS);
+    }
+
+    if (!written) {
+        cout << "Could not write " << out_path << endl;
+        return 1;
+    }
+    return 0;
 }
 
-// Print out the basic stats about the vector, including its sum, mean, median, and range
-void print_stats(vector<double> v) {
-    cout << "Sum = " << sum(v) << endl;
-    cout << "Mean = " << mean(v) << endl;
-    cout << "Median = " << median(v) << endl;
-    cout << "Range = " << range(v) << endl;
+/* print the stats of every other column for each distinct value of the key columns
+ * keys = comma-separated names of the key columns, for example "chas" or "pclass,sex"
+ */
+int print_groups(const CsvTable& table, const string& keys, int threads) {
+    // split the key names and find their columns
+    vector<size_t> key_index;
+    string name;
+    for (size_t i = 0; i <= keys.size(); i++) {
+        if (i == keys.size() || keys[i] == ',') {
+            auto found = find(table.header.begin(), table.header.end(), name);
+            if (found == table.header.end()) {
+                cout << "No column named " << name << endl;
+                return 1;
+            }
+            key_index.push_back(found - table.header.begin());
+            name.clear();
+        }
+        else {
+            name += keys[i];
+        }
+    }
+
+    vector<const vector<double>*> key_columns;
+    vector<const vector<double>*> value_columns;
+    vector<string> value_names;
+    for (size_t c = 0; c < table.columns.size(); c++) {
+        if (find(key_index.begin(), key_index.end(), c) != key_index.end()) {
+            continue;
+        }
+        value_columns.push_back(&table.columns[c]);
+        value_names.push_back(table.header[c]);
+    }
+    for (size_t k : key_index) {
+        key_columns.push_back(&table.columns[k]);
+    }
+
+    // one pass over the rows builds every group
+    GroupTable groups = groupBy(key_columns, value_columns, threads);
+
+    // print the groups sorted by their keys
+    vector<size_t> order(groups.groups());
+    for (size_t g = 0; g < order.size(); g++) {
+        order[g] = g;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return lexicographical_compare(groups.key(a), groups.key(a) + key_index.size(),
+            groups.key(b), groups.key(b) + key_index.size());
+    });
+
+    cout << "Stats by " << keys << " (" << groups.groups() << " groups)" << endl;
+    for (size_t g : order) {
+        cout << endl;
+        for (size_t k = 0; k < key_index.size(); k++) {
+            cout << (k > 0 ? ", " : "") << table.header[key_index[k]] << " = " << groups.key(g)[k];
+        }
+        cout << endl;
+
+        for (size_t v = 0; v < value_columns.size(); v++) {
+            const RunningStats& stats = groups.stats(g, v);
+            cout << "  " << value_names[v] << ": Count = " << stats.count << ", Sum = " << stats.sum()
+                << ", Mean = " << stats.mean() << ", Variance = " << stats.variance()
+                << ", Range = " << stats.range() << endl;
+        }
+    }
+    return 0;
 }
 
 int main(int argc, char** argv) {
-    ifstream inFS;
-    string line;
-    string rm_in, medv_in;
-    const int MAX_LEN = 1000;
-    vector<double> rm(MAX_LEN);
-    vector<double> medv(MAX_LEN);
-
-    // attempt to open the file
-    cout << "Opening file Boston.csv." << endl;
-
-    inFS.open("Boston.csv");
-    if (!inFS.is_open()) {
-        cout << "Could not open file Boston.csv." << endl;
-        return 1;   // 1=error
+    // number of threads used to read the file and accumulate the stats; can be changed with --threads N
+    int threads = thread::hardware_concurrency();
+    // accuracy of the quantile sketch; --quantiles K turns it on (K=200 is about 1.65% rank error)
+    int sketch_k = 0;
+    // --input PATH reads another file; --matrix cov|cor writes the matrix of every column pair
+    // to stdout, or to --out PATH (binary if PATH ends in .bin)
+    string path = "Boston.csv";
+    string matrix_kind;
+    string out_path;
+    // --groupby COLS prints the stats of the other columns for every value of the key columns;
+    // --skip N ignores N leading columns such as a row id
+    string group_keys;
+    int skip = 0;
+    for (int i = 1; i < argc - 1; i++) {
+        if (string(argv[i]) == "--threads") {
+            threads = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--quantiles") {
+            sketch_k = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--input") {
+            path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--matrix") {
+            matrix_kind = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--out") {
+            out_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--groupby") {
+            group_keys = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--skip") {
+            skip = stoi(argv[i + 1]);
+        }
     }
 
-    // can now use inFS stream like cin stream
-    // file Boston.csv should contain two doubles
-
-    cout << "Reading line 1" << endl;
-    getline(inFS, line);
+    // read the file; it is memory-mapped and parsed straight into the columns
+    if (matrix_kind.empty()) {
+        cout << "Opening file " << path << "." << endl;
+    }
 
-    // echo heading
-    cout << "heading: " << line << endl;
+    CsvTable table;
+    if (!readCsv(path, table, skip, threads)) {
+        cout << table.error << endl;
+        return 1;   // 1=error
+    }
 
-    int numObservations = 0;
-    while (inFS.good()) {
-        getline(inFS, rm_in, ',');
-        getline(inFS, medv_in, '\n');
+    // matrix mode uses every column of the file
+    if (!matrix_kind.empty()) {
+        return write_matrix(table, matrix_kind, out_path, threads);
+    }
 
-        rm.at(numObservations) = stof(rm_in);
-        medv.at(numObservations) = stof(medv_in);
+    if (!group_keys.empty()) {
+        return print_groups(table, group_keys, threads);
+    }
 
-        numObservations++;
+    // otherwise the file should contain two doubles, rm and medv
+    if (table.columns.size() != 2) {
+        cout << "Expected 2 columns in " << path << " but found " << table.columns.size() << endl;
+        return 1;
     }
 
-    rm.resize(numObservations);
-    medv.resize(numObservations);
+    cout << "Reading line 1" << endl;
+    // echo heading
+    cout << "heading: " << table.headerLine << endl;
+
+    vector<double> rm = move(table.columns[0]);
+    vector<double> medv = move(table.columns[1]);
+    int numObservations = table.rows;
 
     cout << "new length " << rm.size() << endl;
-    cout << "Closing file Boston.csv." << endl;
-    inFS.close();
+    cout << "Closing file " << path << "." << endl;
 
     cout << "Number of records: " << numObservations << endl;
     cout << "\nStats for rm" << endl;
-    print_stats(rm);
+    print_stats(rm, threads, sketch_k);
 
     cout << "\nStats for medv" << endl;
-    print_stats(medv);
+    print_stats(medv, threads, sketch_k);
 
-    cout << "\nCovariance = " << covar(rm, medv) << endl;
-    cout << "\nCorrelation = " << cor(rm, medv) << endl;
+    // the covariance and correlation share one scan over both columns
+    PairStats rm_medv = collectPairStats(rm, medv, threads);
+    cout << "\nCovariance = " << rm_medv.covariance() << endl;
+    cout << "\nCorrelation = " << rm_medv.correlation() << endl;
     cout << "\nProgram terminated" << endl;
 
     return 0;
@@ -0,0 +1,194 @@
+/*
+Module Name : Group By
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Compute the statistics of some columns separately for every distinct value of one or more key columns
+
+Module Design Description
+GroupTable is an open-addressing hash table (linear probing, power-of-two size) from a key
+(one double per key column) to a group number. The keys and the RunningStats of every group are
+kept in flat arrays in the order the groups were first seen. groupBy splits the rows into one
+contiguous range per thread, builds a table for each range in a single pass, and merges the
+tables in range order at the end, so the groups come out in the order they first appear in
+the data.
+*/
+
+#ifndef GROUP_BY_H
+#define GROUP_BY_H
+
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "StreamingStats.h"
+
+// smallest number of rows worth giving their own thread
+const size_t MIN_GROUP_ROWS = 1 << 16;
+
+class GroupTable {
+public:
+    GroupTable(size_t keyWidth, size_t numValues) : keyWidth(keyWidth), numValues(numValues) {
+        slots.assign(16, 0);
+    }
+
+    // number of the group with this key, adding the group if it is new
+    size_t findOrAdd(const double* key) {
+        uint64_t hash = hashKey(key);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t slot = slots[i];
+            if (slot == 0) {
+                size_t group = addGroup(key, hash);
+                slots[i] = (uint32_t)group + 1;
+                // keep the table at most half full so probes stay short
+                if (2 * groups() > slots.size()) {
+                    grow();
+                }
+                return group;
+            }
+            if (hashes[slot - 1] == hash && sameKey(slot - 1, key)) {
+                return slot - 1;
+            }
+        }
+    }
+
+    // number of the group with this key, or -1 if there is none
+    long find(const double* key) const {
+        uint64_t hash = hashKey(key);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t slot = slots[i];
+            if (slot == 0) {
+                return -1;
+            }
+            if (hashes[slot - 1] == hash && sameKey(slot - 1, key)) {
+                return (long)slot - 1;
+            }
+        }
+    }
+
+    size_t groups() const { return hashes.size(); }
+    const double* key(size_t group) const { return keys.data() + group * keyWidth; }
+    RunningStats& stats(size_t group, size_t value) { return values[group * numValues + value]; }
+    const RunningStats& stats(size_t group, size_t value) const { return values[group * numValues + value]; }
+
+    // add the groups of another table into this one
+    void merge(const GroupTable& other) {
+        for (size_t g = 0; g < other.groups(); g++) {
+            size_t group = findOrAdd(other.key(g));
+            for (size_t v = 0; v < numValues; v++) {
+                stats(group, v).merge(other.stats(g, v));
+            }
+        }
+    }
+
+private:
+    size_t keyWidth;
+    size_t numValues;
+    // group number + 1 for every slot, 0 if the slot is empty
+    std::vector<uint32_t> slots;
+    std::vector<uint64_t> hashes;
+    std::vector<double> keys;
+    std::vector<RunningStats> values;
+
+    // bit pattern of a key value, with -0 folded into 0 so they land in the same group
+    static uint64_t keyBits(double v) {
+        if (v == 0) {
+            v = 0;
+        }
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t hashKey(const double* key) const {
+        uint64_t hash = 0x9e3779b97f4a7c15ULL;
+        for (size_t k = 0; k < keyWidth; k++) {
+            // splitmix64 finalizer on every key value
+            uint64_t z = hash ^ keyBits(key[k]);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            hash = z ^ (z >> 31);
+        }
+        return hash;
+    }
+
+    bool sameKey(size_t group, const double* key) const {
+        const double* stored = keys.data() + group * keyWidth;
+        for (size_t k = 0; k < keyWidth; k++) {
+            if (keyBits(stored[k]) != keyBits(key[k])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t addGroup(const double* key, uint64_t hash) {
+        hashes.push_back(hash);
+        keys.insert(keys.end(), key, key + keyWidth);
+        values.resize(values.size() + numValues);
+        return hashes.size() - 1;
+    }
+
+    // double the number of slots and re-insert every group
+    void grow() {
+        std::vector<uint32_t> bigger(slots.size() * 2, 0);
+        size_t mask = bigger.size() - 1;
+        for (size_t g = 0; g < groups(); g++) {
+            size_t i = hashes[g] & mask;
+            while (bigger[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            bigger[i] = (uint32_t)g + 1;
+        }
+        slots.swap(bigger);
+    }
+};
+
+/* compute the stats of every value column for every distinct combination of the key columns
+ * all columns must have the same length; threads = number of threads to split the rows across
+ */
+inline GroupTable groupBy(const std::vector<const std::vector<double>*>& keyColumns,
+    const std::vector<const std::vector<double>*>& valueColumns, int threads = 1) {
+    size_t n = keyColumns.empty() ? 0 : keyColumns[0]->size();
+    size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / MIN_GROUP_ROWS));
+
+    std::vector<GroupTable> partial(workers, GroupTable(keyColumns.size(), valueColumns.size()));
+    std::vector<std::thread> pool;
+
+    for (size_t w = 0; w < workers; w++) {
+        auto work = [&, w]() {
+            GroupTable& table = partial[w];
+            std::vector<double> key(keyColumns.size());
+            for (size_t r = n * w / workers; r < n * (w + 1) / workers; r++) {
+                for (size_t k = 0; k < keyColumns.size(); k++) {
+                    key[k] = (*keyColumns[k])[r];
+                }
+                size_t group = table.findOrAdd(key.data());
+                for (size_t v = 0; v < valueColumns.size(); v++) {
+                    table.stats(group, v).add((*valueColumns[v])[r]);
+                }
+            }
+        };
+        if (workers == 1) {
+            work();
+        }
+        else {
+            pool.emplace_back(work);
+        }
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    // merge the ranges in order so the groups keep the order they first appear in
+    for (size_t w = 1; w < workers; w++) {
+        partial[0].merge(partial[w]);
+    }
+    return partial[0];
+}
+
+#endif
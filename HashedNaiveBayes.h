@@ -0,0 +1,416 @@
+/*
+Module Name : Hashed Naive Bayes
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Multinomial and Bernoulli naive Bayes over sparse, feature-hashed rows (event logs, tokens,
+ids), where the features are hashed into millions of buckets and every row only has a few of
+them, with training and scoring costs that grow with the non-zero values and not the buckets
+
+Module Design Description
+Feature names or ids are hashed into buckets with featureBucket and the rows are stored as a
+SparseMatrix whose columns are the buckets. The counts only keep the buckets that occurred:
+BucketTable is an open-addressing hash table (linear probing, power-of-two size, like the
+GroupBy table) from a bucket to one count per class, stored next to each other, and the class
+counts and the total of every class are kept beside it. Multinomial counts add up the values
+of a bucket per class; Bernoulli counts count the rows per class in which a bucket is non-zero.
+countHashedNaiveBayes splits the rows into one contiguous range per thread and merges the
+ranges' tables in order, and counts from other rows (other shards) merge the same way.
+The vocabulary is the buckets that some training row had, the way a tokenizer only knows the
+words it has seen: the Laplace smoothing is spread over those V buckets and not over all the
+buckets (with a million mostly empty buckets, the Bernoulli terms of the empty ones would
+outweigh everything the rows say), and a bucket no training row had is skipped when scoring.
+So scoring never walks the buckets: the score of class c is
+    bias[c] + sum over the row's known buckets of x * weight[bucket][c]
+where for multinomial models bias is the log prior, x the value and weight the smoothed log
+P(bucket | c); for Bernoulli models x is 1, weight the log-odds log(p / (1 - p)) of the bucket
+being non-zero in class c, and bias also holds the sum of log(1 - p) over the vocabulary, which
+is what a row without any non-zero bucket scores. HashedNaiveBayesModel keeps the weights in a
+BucketTable, or in a dense array indexed by bucket when at least 1 / DENSE_BUCKET_SHARE of the
+buckets were seen, which is then smaller and needs no probing. The posteriors come from the
+same log-sum-exp as NaiveBayesModel, over blocks of NAIVE_BAYES_BLOCK rows; large batches are
+split into one range of rows per thread.
+*/
+
+#ifndef HASHED_NAIVE_BAYES_H
+#define HASHED_NAIVE_BAYES_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include "SparseMatrix.h"
+#include "NaiveBayes.h"
+
+// the weights are stored densely once at least 1 / DENSE_BUCKET_SHARE of the buckets are seen
+const size_t DENSE_BUCKET_SHARE = 8;
+// bucket number that marks an empty slot of a BucketTable
+const uint32_t EMPTY_BUCKET = 0xffffffff;
+
+enum HashedNaiveBayesKind {
+    // the values are counts (how often a token occurred in the row)
+    HASHED_MULTINOMIAL,
+    // only whether a value is non-zero matters
+    HASHED_BERNOULLI
+};
+
+// the bucket (0..buckets-1) of a numeric feature id
+inline uint32_t featureBucket(uint64_t id, uint32_t buckets) {
+    // splitmix64 finalizer, so ids that are close together spread over the buckets
+    uint64_t z = id + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)((z ^ (z >> 31)) % buckets);
+}
+
+// the bucket (0..buckets-1) of a feature name such as "pclass=1"
+inline uint32_t featureBucket(const std::string& name, uint32_t buckets) {
+    // 64-bit FNV-1a over the bytes
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : name) {
+        hash = (hash ^ ch) * 0x100000001b3ULL;
+    }
+    return featureBucket(hash, buckets);
+}
+
+// open-addressing table from a bucket number to width doubles
+class BucketTable {
+public:
+    explicit BucketTable(size_t width = 0) : width(width) {
+        keys.assign(16, EMPTY_BUCKET);
+        entries.assign(keys.size() * width, 0);
+    }
+
+    // the values of bucket, added as zeros if it is new
+    double* findOrAdd(uint32_t bucket) {
+        size_t mask = keys.size() - 1;
+        for (size_t i = slotOf(bucket, mask);; i = (i + 1) & mask) {
+            if (keys[i] == bucket) {
+                return entries.data() + i * width;
+            }
+            if (keys[i] == EMPTY_BUCKET) {
+                // keep the table at most half full so probes stay short
+                if (2 * (used + 1) > keys.size()) {
+                    grow();
+                    return findOrAdd(bucket);
+                }
+                keys[i] = bucket;
+                used++;
+                return entries.data() + i * width;
+            }
+        }
+    }
+
+    // the values of bucket, or nullptr if it was never added
+    const double* find(uint32_t bucket) const {
+        size_t mask = keys.size() - 1;
+        for (size_t i = slotOf(bucket, mask);; i = (i + 1) & mask) {
+            if (keys[i] == bucket) {
+                return entries.data() + i * width;
+            }
+            if (keys[i] == EMPTY_BUCKET) {
+                return nullptr;
+            }
+        }
+    }
+
+    // number of buckets added
+    size_t size() const { return used; }
+    size_t valuesPerBucket() const { return width; }
+
+    // the buckets are read slot by slot: slot s holds bucket(s) (EMPTY_BUCKET if none) and values(s)
+    size_t slots() const { return keys.size(); }
+    uint32_t bucket(size_t s) const { return keys[s]; }
+    const double* values(size_t s) const { return entries.data() + s * width; }
+
+    // add the values of another table with the same width into this one
+    void merge(const BucketTable& other) {
+        for (size_t s = 0; s < other.slots(); s++) {
+            if (other.keys[s] != EMPTY_BUCKET) {
+                double* mine = findOrAdd(other.keys[s]);
+                for (size_t k = 0; k < width; k++) {
+                    mine[k] += other.entries[s * width + k];
+                }
+            }
+        }
+    }
+
+private:
+    size_t width;
+    size_t used = 0;
+    std::vector<uint32_t> keys;
+    std::vector<double> entries;
+
+    static size_t slotOf(uint32_t bucket, size_t mask) {
+        // Fibonacci hashing; the top bits of the product are the best mixed
+        return (size_t)(((uint64_t)bucket * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+    }
+
+    // double the number of slots and re-insert every bucket
+    void grow() {
+        std::vector<uint32_t> biggerKeys(keys.size() * 2, EMPTY_BUCKET);
+        std::vector<double> biggerEntries(biggerKeys.size() * width, 0);
+        size_t mask = biggerKeys.size() - 1;
+        for (size_t s = 0; s < keys.size(); s++) {
+            if (keys[s] == EMPTY_BUCKET) {
+                continue;
+            }
+            size_t i = slotOf(keys[s], mask);
+            while (biggerKeys[i] != EMPTY_BUCKET) {
+                i = (i + 1) & mask;
+            }
+            biggerKeys[i] = keys[s];
+            std::copy(entries.begin() + s * width, entries.begin() + (s + 1) * width, biggerEntries.begin() + i * width);
+        }
+        keys.swap(biggerKeys);
+        entries.swap(biggerEntries);
+    }
+};
+
+struct HashedNaiveBayesCounts {
+    HashedNaiveBayesKind kind;
+    uint32_t buckets;
+    // rows of every class
+    std::vector<size_t> classCounts;
+    // per class: the sum of all values (multinomial) or the number of non-zero buckets (Bernoulli)
+    std::vector<double> classTotals;
+    // per seen bucket and class: the sum of its values (multinomial) or the rows it is non-zero in (Bernoulli)
+    BucketTable features;
+
+    HashedNaiveBayesCounts(HashedNaiveBayesKind kind = HASHED_MULTINOMIAL, size_t classes = 2, uint32_t buckets = 1 << 20)
+        : kind(kind), buckets(buckets), classCounts(classes, 0), classTotals(classes, 0), features(classes) {}
+
+    size_t classes() const { return classCounts.size(); }
+
+    // true if other counts the same kind of model over the same buckets and classes
+    bool sameShape(const HashedNaiveBayesCounts& other) const {
+        return kind == other.kind && buckets == other.buckets && classes() == other.classes();
+    }
+
+    // add the counts of other rows with the same shape
+    void merge(const HashedNaiveBayesCounts& other) {
+        for (size_t c = 0; c < classes(); c++) {
+            classCounts[c] += other.classCounts[c];
+            classTotals[c] += other.classTotals[c];
+        }
+        features.merge(other.features);
+    }
+};
+
+/* count the rows of x (columns = buckets) by their labels (class codes below counts.classes())
+ * (a column of any type) into counts, in one pass over the non-zero values split across threads
+ * returns false with error set if a label is not a class code, a column is not a bucket, or a
+ * multinomial value is negative
+ */
+inline bool countHashedNaiveBayes(const SparseMatrix& x, ColumnRef labels, HashedNaiveBayesCounts& counts,
+    std::string& error, int threads = 1) {
+    size_t n = x.rows();
+    size_t classes = counts.classes();
+    bool bernoulli = counts.kind == HASHED_BERNOULLI;
+    size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / MIN_NAIVE_BAYES_ROWS));
+
+    HashedNaiveBayesCounts empty(counts.kind, classes, counts.buckets);
+    std::vector<HashedNaiveBayesCounts> partial(workers, empty);
+    // first row of each range that cannot be counted, or n if there is none
+    std::vector<size_t> badRow(workers, n);
+    std::vector<std::thread> pool;
+    const uint32_t* columns = x.columnIndex();
+    const double* values = x.values();
+
+    for (size_t w = 0; w < workers; w++) {
+        auto work = [&, w]() {
+            HashedNaiveBayesCounts& table = partial[w];
+            labels.visit([&](const auto* label) {
+                for (size_t r = n * w / workers; r < n * (w + 1) / workers; r++) {
+                    size_t c;
+                    if (!categoryCode(label[r], c) || c >= classes) {
+                        badRow[w] = r;
+                        return;
+                    }
+                    table.classCounts[c]++;
+                    for (size_t k = x.rowBegin(r); k < x.rowEnd(r); k++) {
+                        if (columns[k] >= counts.buckets || (!bernoulli && values[k] < 0)) {
+                            badRow[w] = r;
+                            return;
+                        }
+                        // a row's columns are sorted, so a bucket two names hashed to is counted once
+                        if (bernoulli && k > x.rowBegin(r) && columns[k] == columns[k - 1]) {
+                            continue;
+                        }
+                        double amount = bernoulli ? 1 : values[k];
+                        table.features.findOrAdd(columns[k])[c] += amount;
+                        table.classTotals[c] += amount;
+                    }
+                }
+            });
+        };
+        if (workers == 1) {
+            work();
+        }
+        else {
+            pool.emplace_back(work);
+        }
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    for (size_t w = 0; w < workers; w++) {
+        if (badRow[w] < n) {
+            error = "Row " + std::to_string(badRow[w] + 1) + " has a class that is not a whole number below "
+                + std::to_string(classes) + ", a bucket of " + std::to_string(counts.buckets) + " or more, or a negative count";
+            return false;
+        }
+    }
+
+    // merge the ranges in order so the counts do not depend on which thread finished first
+    for (size_t w = 0; w < workers; w++) {
+        counts.merge(partial[w]);
+    }
+    return true;
+}
+
+class HashedNaiveBayesModel {
+public:
+    /* build the model from counts with Laplace smoothing alpha (added to the count of every
+     * bucket of the vocabulary); a class without rows gets probability 0
+     */
+    void fit(const HashedNaiveBayesCounts& counts, double alpha = 1) {
+        kind = counts.kind;
+        buckets = counts.buckets;
+        numClasses = counts.classes();
+        const BucketTable& seen = counts.features;
+        double vocabulary = (double)seen.size();
+
+        double rows = 0;
+        for (size_t c = 0; c < numClasses; c++) {
+            rows += (double)counts.classCounts[c];
+        }
+        bias.assign(numClasses, 0);
+        // the smoothed denominator of every class
+        std::vector<double> denominator(numClasses);
+        for (size_t c = 0; c < numClasses; c++) {
+            bias[c] = std::log(counts.classCounts[c] / rows);
+            denominator[c] = kind == HASHED_MULTINOMIAL ? counts.classTotals[c] + alpha * vocabulary
+                : counts.classCounts[c] + 2 * alpha;
+        }
+
+        dense = seen.size() * DENSE_BUCKET_SHARE >= buckets;
+        table = BucketTable(dense ? 0 : numClasses);
+        denseWeights.assign(dense ? (size_t)buckets * numClasses : 0, 0);
+        for (size_t s = 0; s < seen.slots(); s++) {
+            uint32_t bucket = seen.bucket(s);
+            if (bucket == EMPTY_BUCKET) {
+                continue;
+            }
+            const double* count = seen.values(s);
+            double* weight = dense ? denseWeights.data() + (size_t)bucket * numClasses : table.findOrAdd(bucket);
+            for (size_t c = 0; c < numClasses; c++) {
+                double p = (count[c] + alpha) / denominator[c];
+                if (kind == HASHED_MULTINOMIAL) {
+                    weight[c] = std::log(p);
+                }
+                else {
+                    weight[c] = std::log(p) - std::log1p(-p);
+                    bias[c] += std::log1p(-p);
+                }
+            }
+        }
+    }
+
+    HashedNaiveBayesKind modelKind() const { return kind; }
+    size_t classes() const { return numClasses; }
+    uint32_t bucketCount() const { return buckets; }
+    // true if the weights are a dense array over all buckets rather than a hash table of the seen ones
+    bool isDense() const { return dense; }
+
+    /* posterior probabilities of every class for every row of x (columns = buckets)
+     * posteriors receives x.rows() x classes() values, row after row; large batches are split across threads
+     */
+    void predictBatch(const SparseMatrix& x, double* posteriors, int threads = 1) const {
+        size_t n = x.rows();
+        size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / MIN_NAIVE_BAYES_ROWS));
+        if (workers == 1) {
+            scoreRows(x, 0, n, posteriors);
+            return;
+        }
+        std::vector<std::thread> pool;
+        for (size_t w = 0; w < workers; w++) {
+            size_t begin = n * w / workers;
+            size_t end = n * (w + 1) / workers;
+            pool.emplace_back([=, &x]() { scoreRows(x, begin, end, posteriors + begin * numClasses); });
+        }
+        for (std::thread& t : pool) {
+            t.join();
+        }
+    }
+
+private:
+    HashedNaiveBayesKind kind = HASHED_MULTINOMIAL;
+    uint32_t buckets = 0;
+    size_t numClasses = 0;
+    // score of class c = bias[c] + the weights of the row's known buckets
+    std::vector<double> bias;
+    bool dense = false;
+    BucketTable table;
+    // bucket * classes + c when dense; 0 for a bucket outside the vocabulary
+    std::vector<double> denseWeights;
+
+    // the weights of bucket for every class, or nullptr if it is outside the vocabulary
+    const double* weights(uint32_t bucket) const {
+        if (dense) {
+            return bucket < buckets ? denseWeights.data() + (size_t)bucket * numClasses : nullptr;
+        }
+        return table.find(bucket);
+    }
+
+    // predictBatch of rows [begin, end) on the calling thread
+    void scoreRows(const SparseMatrix& x, size_t begin, size_t end, double* posteriors) const {
+        bool bernoulli = kind == HASHED_BERNOULLI;
+        const uint32_t* columns = x.columnIndex();
+        const double* values = x.values();
+        // the block's scores, one array of rows per class
+        std::vector<double> scores(numClasses * NAIVE_BAYES_BLOCK);
+        std::vector<char> unknown(NAIVE_BAYES_BLOCK);
+
+        for (size_t first = begin; first < end; first += NAIVE_BAYES_BLOCK) {
+            size_t len = std::min(NAIVE_BAYES_BLOCK, end - first);
+            for (size_t c = 0; c < numClasses; c++) {
+                std::fill(scores.begin() + c * NAIVE_BAYES_BLOCK, scores.begin() + c * NAIVE_BAYES_BLOCK + len, bias[c]);
+            }
+            std::fill(unknown.begin(), unknown.begin() + len, 0);
+
+            // only the non-zero values of each row are read
+            for (size_t r = 0; r < len; r++) {
+                size_t row = first + r;
+                for (size_t k = x.rowBegin(row); k < x.rowEnd(row); k++) {
+                    if (bernoulli && k > x.rowBegin(row) && columns[k] == columns[k - 1]) {
+                        continue;
+                    }
+                    const double* weight = weights(columns[k]);
+                    if (weight == nullptr) {
+                        continue;
+                    }
+                    double amount = bernoulli ? 1 : values[k];
+                    for (size_t c = 0; c < numClasses; c++) {
+                        scores[c * NAIVE_BAYES_BLOCK + r] += amount * weight[c];
+                    }
+                }
+            }
+
+            normalizeScores(scores.data(), NAIVE_BAYES_BLOCK, numClasses, len, unknown.data());
+            double* out = posteriors + (first - begin) * numClasses;
+            for (size_t r = 0; r < len; r++) {
+                for (size_t c = 0; c < numClasses; c++) {
+                    out[r * numClasses + c] = unknown[r] ? std::numeric_limits<double>::quiet_NaN() : scores[c * NAIVE_BAYES_BLOCK + r];
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -18,349 +18,363 @@ The weights w0 and w1 represent the intercept and sexmale coefficients when ran
 */
 
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <thread>
+#include "CsvReader.h"
+#include "ColumnCache.h"
+#include "Matrix.h"
+#include "SparseMatrix.h"
+#include "LogisticKernels.h"
+#include "LogisticSolvers.h"
+#include "ModelFile.h"
+#include "ScoringServer.h"
+#include "CrossValidation.h"
+#include "Metrics.h"
 
 using namespace std;
 using namespace std::chrono;
 
-// sigmoid function
-double sigmoid(double z) {
-    return 1.0 / (1 + exp(-1 * z));
-}
-
-// computes the sigmoid values for every observation in the input matrix
-vector<double> findSigValues(vector<vector<double>> matrix, vector<double> weights) {
-    vector<double> sigValues(matrix[0].size());
-
-    // generate sigmoid vector
-    for (int i = 0; i < matrix[0].size(); i++) {
-        double z = 0;
-        // multiply every row by the weights
-        for (int j = 0; j < matrix.size(); j++) {
-            z += matrix[j][i] * weights[j];
-        }
-
-        // find the sigmoid value
-        sigValues[i] = sigmoid(z);
-    }
-
-    return sigValues;
+// compute the predicted values
+// weights = calculated coefficients; test_matrix = test data (dense or sparse); mode = exact or fast sigmoid
+template <typename Data>
+vector<double> predictValues(const Vector& weights, const Data& test_matrix, SigmoidMode mode) {
+    // probs = e^(Xw) / (1 + e^(Xw)), computed block by block straight into probs with the batch sigmoid
+    vector<double> probs(test_matrix.rows());
+    logisticPredict(test_matrix, weights, probs.data(), mode);
+    return probs;
 }
 
-// subtracts elements of v2 from elements of v1 and returns resulting vector
-vector<double> vectorSubtraction(vector<double> v1, vector<double> v2) {
-    vector<double> result(v1.size());
-
-    // for every element, subtract v2[i] from v1[i] and set result[i] equal to that
-    for (int i = 0; i < v1.size(); i++) {
-        result[i] = v1[i] - v2[i];
-    }
-
-    return result;
+// Computes the coefficients of the logistic regression function
+// matrix = one row per observation (dense Matrix, RowView or SparseMatrix), the first column all 1s for the intercept
+// solver = one of the solvers in LogisticSolvers.h (newton, gd, lbfgs, sgd, hogwild); options = stopping rules and threads
+// the weights get one entry per column of the matrix
+template <typename Data>
+SolverResult logistic(const Data& data_matrix, const Vector& labels, LogisticSolver<Data> solver, const SolverOptions& options) {
+    return solver(data_matrix, labels, options);
 }
 
-// adds elements of v2 to elements of v1 and returns resulting vector
-vector<double> vectorAddition(vector<double> v1, vector<double> v2) {
-    vector<double> result(v1.size());
-
-    // for every index i, add the elements in that position in v1 and v2 and set result[i] equal to that
-    for (int i = 0; i < v1.size(); i++) {
-        result[i] = v1[i] + v2[i];
-    }
-
-    return result;
+// save the weights to a model file that --score can load
+bool saveModel(const Vector& weights, const string& path, string& error) {
+    ModelWriter writer(MODEL_LOGISTIC);
+    writer.add("weights", 1, weights.size(), weights.data());
+    return writer.write(path, error);
 }
 
-// divides elements of v1 by elements of v2 and returns resulting vector
-vector<double> vectorDivision(vector<double> v1, vector<double> v2) {
-    vector<double> result(v1.size());
-
-    // for all elements, divided v1[i] by v2[i] and set result[i] equal to that
-    for (int i = 0; i < v1.size(); i++) {
-        result[i] = v1[i] / v2[i];
+/* load a saved model once and score rows from stdin (or a Unix socket if socket_path is set)
+ * every row holds the features without the intercept; one probability is written per row
+ * batch = most rows scored together; mode = exact or fast sigmoid
+ */
+int scoreModel(const string& model_path, const string& socket_path, size_t batch, SigmoidMode mode) {
+    string error;
+    ModelFile model;
+    if (!model.open(model_path, error)) {
+        cerr << error << endl;
+        return 1;   // 1=error
     }
-
-    return result;
-}
-
-// take the power of eof every element in the vector and return it as a new vector
-// so in the resulting vector every index has result[i] = (e^v1[i])
-vector<double> vectorExp(vector<double> v1) {
-    vector<double> result(v1.size());
-
-    for (int i = 0; i < v1.size(); i++) {
-        result[i] = exp(v1[i]);
+    size_t rows = 0;
+    size_t numWeights = 0;
+    const double* weights = model.find("weights", rows, numWeights);
+    if (model.kind() != MODEL_LOGISTIC || weights == nullptr || rows != 1 || numWeights < 1) {
+        cerr << model_path << " is not a logistic regression model" << endl;
+        return 1;
     }
-
-    return result;
-}
-
-// finds and returns the transpose of a matrix
-vector<vector<double>> matrixTranspose(vector<vector<double>> matrix) {
-    // result is the transpose matrix
-    vector<vector<double>> result(matrix[0].size(), vector<double>(matrix.size()));
-
-    // set all rows of input matrix to columns of the result matrix
-    for (int i = 0; i < matrix[0].size(); i++) {
-        vector<double> temp(matrix.size());
-        // get the row of the input matrix
-        for (int j = 0; j < matrix.size(); j++) {
-            temp[j] = matrix[j][i];
+    size_t width = numWeights - 1;
+
+    // z = w0 + w . x for every row, then the batch sigmoid in place
+    auto score = [&](const double* features, size_t n, double* probs) {
+        for (size_t r = 0; r < n; r++) {
+            double z = weights[0];
+            for (size_t j = 0; j < width; j++) {
+                z += weights[j + 1] * features[r * width + j];
+            }
+            probs[r] = z;
         }
-
-        // set result column to temp
-        result[i] = temp;
+        batchSigmoid(probs, probs, n, mode);
+    };
+    auto report = [](const LatencyReport& latency) {
+        cerr << "scored " << latency.rows << " rows in " << latency.batches << " batches; latency p50 = "
+            << latency.p50 << " us, p99 = " << latency.p99 << " us" << endl;
+    };
+
+    if (!socket_path.empty()) {
+        auto served = [&](const LatencyReport& latency, const string& clientError) {
+            if (!clientError.empty()) {
+                cerr << clientError << endl;
+            }
+            report(latency);
+        };
+        serveUnixSocket(socket_path, width, batch, score, served, error);
+        cerr << error << endl;
+        return 1;
     }
-
-    return result;
-}
-
-// a matrix nxm is multipled by a matrix of mx1, resulting in matrix nx1
-vector<double> matrixMultiplication(vector<vector<double>> matrix, vector<double> v1) {
-    vector<double> result(matrix[0].size());
-
-    for (int i = 0; i < matrix[0].size(); i++) {
-        double z = 0;
-        // find sum of multiplying an entire row of the input matrix by a column of v1
-        for (int j = 0; j < matrix.size(); j++) {
-            z += matrix[j][i] * v1[j];
-        }
-        // set column in matrix result to that sum (z)
-        result[i] = z;
+    LatencyReport latency;
+    if (!serveScores(0, 1, width, batch, score, latency, error)) {
+        cerr << error << endl;
+        return 1;
     }
-
-    return result;
+    report(latency);
+    return 0;
 }
 
-// multiply the matrix by a constant (scalar)
-vector<double> scalarMultiplication(vector<double> matrix, double scalar) {
-    vector<double> result(matrix.size());
-
-    // multiply every element in the input matrix by the scalar
-    for (int i = 0; i < matrix.size(); i++) {
-        result[i] = matrix[i] * scalar;
+// the numbers of a comma-separated list such as "0.1,0.01", or just fallback if the list is empty
+vector<double> numberList(const string& list, double fallback) {
+    if (list.empty()) {
+        return { fallback };
     }
-
-    return result;
-}
-
-// compute the predicted values
-// weights = calculated coefficients; test_matrix = test data
-vector<double> predictValues(vector<double> weights, vector<vector<double>> test_matrix) {
-    // multiply the test matrix by the weight coefficients from the training algorithm
-    vector<double> predicted = matrixMultiplication(test_matrix, weights);
-
-    // raise every value to be e^value
-    vector<double> predExp = vectorExp(predicted);
-    // makes a vector that consists of only 1s
-    vector<double> ones(predExp.size(), 1.0);
-    // adds the vectors predExp and ones together
-    vector<double> predExpPlusOne = vectorAddition(predExp, ones);
-    // divides predExp by predExpPlusOne to get probabilities
-    vector<double> probs = vectorDivision(predExp, predExpPlusOne);
-
-    return probs;
+    vector<double> numbers;
+    for (const string& item : splitList(list)) {
+        numbers.push_back(stod(item));
+    }
+    return numbers;
 }
 
-// round the predicted probabilities to 1 or 0
-// probs = predicted probabilities
-vector<double> roundProbs(vector<double> probs) {
-    vector<double> predictions(probs.size());
-
-    // if a survived probability > 0.5 then set probability to 1; otherwise, set it to 0
-    for (int i = 0; i < probs.size(); i++) {
-        if (probs[i] > 0.5) {
-            predictions[i] = 1;
+/* cross-validate every combination of the solvers, learning rates and L2 strengths on k folds
+ * of the training rows and print the mean and standard deviation of each one's scores
+ * labels = one per training row; base = the options every combination starts from
+ */
+int runCrossValidation(const RowView& train, const Vector& labels, int k, bool stratify,
+    const vector<string>& solvers, const vector<double>& rates, const vector<double>& penalties,
+    const SolverOptions& base, int threads) {
+    vector<GridPoint> grid;
+    for (const string& solver : solvers) {
+        if (findSolver<RowView>(solver) == nullptr) {
+            cout << "Unknown solver " << solver << "; expected newton, gd, lbfgs, sgd or hogwild" << endl;
+            return 1;   // 1=error
         }
-        else {
-            predictions[i] = 0;
+        for (double rate : rates) {
+            for (double penalty : penalties) {
+                GridPoint point = { solver, base };
+                point.options.learningRate = rate;
+                point.options.l2 = penalty;
+                grid.push_back(point);
+            }
         }
     }
-    return predictions;
-}
 
-/* find the accuracy of the model using the formula accuracy = correct/total
- * predictions = vector of probabilities 1 or 0
- * lbls = survived vector
- */
-double accuracy(vector<double> predictions, vector<double> lbls) {
-    double correct = 0;
-    // find the amount of correct predictions
-    for (int i = 0; i < predictions.size(); i++) {
-        if (predictions[i] == lbls[i]) {
-            correct++;
+    vector<Fold> folds = makeFolds(labels.data(), labels.size(), k, stratify, base.seed);
+    time_point<system_clock> start = system_clock().now();
+    vector<CvResult> results = crossValidate(train, labels, folds, grid, threads);
+    duration<double> elapsed_time = system_clock().now() - start;
+
+    cout << folds.size() << "-fold " << (stratify ? "stratified " : "") << "cross-validation of "
+        << grid.size() << " settings" << endl;
+    size_t best = 0;
+    for (size_t g = 0; g < results.size(); g++) {
+        const CvResult& result = results[g];
+        cout << result.point.solver << " lr = " << result.point.options.learningRate << " l2 = " << result.point.options.l2
+            << ": accuracy = " << result.accuracy.mean() << " (sd " << result.accuracy.sd() << "), log-loss = "
+            << result.logLoss.mean() << " (sd " << result.logLoss.sd() << ")" << endl;
+        if (result.logLoss.mean() < results[best].logLoss.mean()) {
+            best = g;
         }
     }
-
-    // calculate accuracy
-    double acc = correct / predictions.size();
-
-    return acc;
+    cout << "best (lowest log-loss): " << results[best].point.solver << " lr = " << results[best].point.options.learningRate
+        << " l2 = " << results[best].point.options.l2 << endl;
+    cout << "elapsed time (seconds) = " << elapsed_time.count() << endl;
+    return 0;
 }
 
-/* find the sensitivity of the model using the formula sensitivity = tp/(tp+fn)
- * predictions = vector of probabilities 1 or 0
- * lbls = survived vector
- */
-double sensitivity(vector<double> predictions, vector<double> lbls) {
-    // tp = true positive; fn = false negative
-    double tp = 0;
-    double fn = 0;
-
-    // find tp and fn
-    for (int i = 0; i < predictions.size(); i++) {
-        if (predictions[i] == 0 && lbls[i] == 0) {
-            tp++;
+int main(int argc, char** argv) {
+    // number of threads used to read the file and train; can be changed with --threads N
+    int threads = thread::hardware_concurrency();
+    // --solver gd|newton|lbfgs|sgd|hogwild picks the training method (gradient descent by default);
+    // --tol, --max-iter and --lr change when it stops and --l2 adds a penalty; Newton's method
+    // converges in a few passes when there are few columns; --batch, --epochs, --shuffle 0|1 and
+    // --decay set up SGD
+    // --format sparse stores the features as a sparse matrix; --sigmoid fast uses the polynomial sigmoid
+    // --save-model PATH saves the weights; --score PATH loads them and scores rows from stdin (or
+    // --socket PATH) in batches of up to --score-batch rows instead of training
+    // --cv K cross-validates on K folds of the training data (--stratify 1 keeps the classes balanced)
+    // every combination of --grid-solver, --grid-lr and --grid-l2 (comma-separated lists) instead
+    // --train-rows N trains on N rows (800 by default) and tests on the rest; --split first takes the
+    // first N rows, --split shuffle or stratified (classes balanced) picks them at random with --seed
+    string solver_name = "gd";
+    string format = "dense";
+    string sigmoid_name = "exact";
+    string save_path;
+    string score_path;
+    string socket_path;
+    size_t score_batch = 256;
+    int cv_folds = 0;
+    bool stratify = false;
+    string grid_solvers;
+    string grid_rates;
+    string grid_penalties;
+    string split_name = "first";
+    size_t train_size = 800;
+    SolverOptions options;
+    for (int i = 1; i < argc - 1; i++) {
+        if (string(argv[i]) == "--threads") {
+            threads = stoi(argv[i + 1]);
         }
-        else if (predictions[i] == 1 && lbls[i] == 0) {
-            fn++;
+        else if (string(argv[i]) == "--solver") {
+            solver_name = argv[i + 1];
         }
-    }
-
-    // check that the denominator isn't zero because then sensitivity is undefined
-    if ((tp + fn) == 0) {
-        return -1;
-    }
-
-    // calculate and return sensitivity
-    return tp / (tp + fn);
-}
-
-/* find the specificity of the model using the formula specificity = tn/(tn+fp)
- * predictions = vector of probabilities 1 or 0
- * lbls = survived vector
- */
-double specificity(vector<double> predictions, vector<double> lbls) {
-    // tn = true negative; fp = false positive
-    double tn = 0;
-    double fp = 0;
-
-    // find tn and fp
-    for (int i = 0; i < predictions.size(); i++) {
-        if (predictions[i] == 1 && lbls[i] == 1) {
-            tn++;
+        else if (string(argv[i]) == "--tol") {
+            options.gradientTolerance = stod(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--max-iter") {
+            options.maxIterations = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--lr") {
+            options.learningRate = stod(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--l2") {
+            options.l2 = stod(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--batch") {
+            options.batchSize = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--epochs") {
+            options.epochs = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--shuffle") {
+            options.shuffle = stoi(argv[i + 1]) != 0;
+        }
+        else if (string(argv[i]) == "--decay") {
+            options.learningRateDecay = stod(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--format") {
+            format = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--sigmoid") {
+            sigmoid_name = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--save-model") {
+            save_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--score") {
+            score_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--socket") {
+            socket_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--score-batch") {
+            score_batch = stoul(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--cv") {
+            cv_folds = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--stratify") {
+            stratify = stoi(argv[i + 1]) != 0;
+        }
+        else if (string(argv[i]) == "--grid-solver") {
+            grid_solvers = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--grid-lr") {
+            grid_rates = argv[i + 1];
         }
-        else if (predictions[i] == 0 && lbls[i] == 1) {
-            fp++;
+        else if (string(argv[i]) == "--grid-l2") {
+            grid_penalties = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--split") {
+            split_name = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--train-rows") {
+            train_size = stoul(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--seed") {
+            options.seed = stoul(argv[i + 1]);
         }
     }
-
-    // check that the denominator isn't zero because then specificity is undefined
-    if ((tn + fp) == 0) {
-        return -1;
+    if (findSolver<RowView>(solver_name) == nullptr) {
+        cout << "Unknown solver " << solver_name << "; expected newton, gd, lbfgs, sgd or hogwild" << endl;
+        return 1;   // 1=error
     }
-
-    // calculate and return specificity
-    return tn / (tn + fp);
-}
-
-// Computes the coefficients of the logistic regression function
-vector<double> logistic(vector<vector<double>> matrix, vector<double> lbls) {
-    vector<double> weights = { 1,1 };
-    double learning_rate = 0.001;
-    vector<double> labels = lbls;
-
-    vector<vector<double>> data_matrix = matrix;
-    vector<double> probs(data_matrix[0].size());
-    vector<double> errors(data_matrix[0].size());
-
-    // gradient descent for 50000 iterations
-    for (int i = 1; i < 50000; i++) {
-        // get the sigmoid values of the input matrix
-        probs = findSigValues(data_matrix, weights);
-        // caculate errors
-        errors = vectorSubtraction(labels, probs);
-        // calculate new weights
-        vector<double> temp = matrixMultiplication(matrixTranspose(data_matrix), errors);
-        weights = vectorAddition(weights, scalarMultiplication(temp, learning_rate));
+    if (format != "dense" && format != "sparse") {
+        cout << "Unknown format " << format << "; expected dense or sparse" << endl;
+        return 1;
     }
-
-    return weights;
-}
-
-int main(int argc, char** argv) {
-    ifstream inFS;
-    string line;
-    string pclass_in, survived_in, sex_in, age_in;
-    const int MAX_LEN = 1100;
-    vector<double> pclass(MAX_LEN);
-    vector<double> survived(MAX_LEN);
-    vector<double> sex(MAX_LEN);
-    vector<double> age(MAX_LEN);
+    if (split_name != "first" && split_name != "shuffle" && split_name != "stratified") {
+        cout << "Unknown split " << split_name << "; expected first, shuffle or stratified" << endl;
+        return 1;
+    }
+    if (!parseSigmoidMode(sigmoid_name, options.sigmoidMode)) {
+        cout << "Unknown sigmoid " << sigmoid_name << "; expected exact or fast" << endl;
+        return 1;
+    }
+    if (!score_path.empty()) {
+        return scoreModel(score_path, socket_path, score_batch, options.sigmoidMode);
+    }
+    options.threads = threads;
 
     // attempt to open the file
     cout << "Opening file titanic_project.csv." << endl;
 
-    inFS.open("titanic_project.csv");
-    if (!inFS.is_open()) {
-        cout << "Could not open file" << endl;
+    // the file is memory-mapped and parsed straight into the columns, or its binary column
+    // cache (titanic_project.csv.cols) is mapped and read in place if it was built from the
+    // same file
+    // the first column is the row id, which is not used
+    TypedTable table;
+    bool fromCache = false;
+    if (!readTypedCsvCached("titanic_project.csv", table, 1, threads, fromCache)) {
+        cout << table.error << endl;
         return 1;   // 1=error
     }
+    if (fromCache) {
+        cout << "Using cached columns from titanic_project.csv.cols" << endl;
+    }
 
-    // can now use inFS stream like cin stream
     // file titanic_project.csv should contain 4 doubles
+    if (table.columns.size() != 4) {
+        cout << "Expected 4 columns in titanic_project.csv but found " << table.columns.size() << endl;
+        return 1;
+    }
+    for (size_t c = 0; c < table.columns.size(); c++) {
+        if (table.columns[c].categorical()) {
+            cout << "Expected numbers in column " << table.header[c] << " of titanic_project.csv" << endl;
+            return 1;
+        }
+    }
 
     cout << "Reading line 1" << endl;
-    getline(inFS, line);
-
     // echo heading
-    cout << "heading: " << line << endl;
-
-    int numObservations = 0;
-    while (inFS.good()) {
-        getline(inFS, line, ',');
-        // read the data into the corresponding category
-        getline(inFS, pclass_in, ',');
-        getline(inFS, survived_in, ',');
-        getline(inFS, sex_in, ',');
-        getline(inFS, age_in, '\n');
-
-        // convert the data from string to integer
-        pclass.at(numObservations) = stof(pclass_in);
-        survived.at(numObservations) = stof(survived_in);
-        sex.at(numObservations) = stof(sex_in);
-        age.at(numObservations) = stof(age_in);
-
-        numObservations++;
-    }
+    cout << "heading: " << table.headerLine << endl;
 
-    // resize each vector to be an exact fit
-    pclass.resize(numObservations);
-    survived.resize(numObservations);
-    sex.resize(numObservations);
-    age.resize(numObservations);
+    size_t numObservations = table.rows;
 
-    cout << "new length " << pclass.size() << endl;
+    cout << "new length " << table.rows << endl;
     cout << "Closing file" << endl;
-    inFS.close();
 
     cout << "Number of records: " << numObservations << endl << endl;
 
-    // train data
-    vector<vector<double>> train(2, vector<double>(800));
-    for (int i = 0; i < 800; i++) {
-        train[0][i] = survived[i];
-        train[1][i] = sex[i];
+    // the feature (sex) of every row in the aligned matrix the kernels read, and the labels
+    // (survived); the train and test data are views of its rows with an implicit intercept
+    // column of 1s in front, so splitting costs at most two arrays of row numbers
+    Matrix features(numObservations, 1);
+    table.columns[2].gather(0, numObservations, features.column(0), 1);
+    Vector survived(numObservations);
+    table.columns[1].gather(0, numObservations, survived.data(), 1);
+    table = TypedTable();
+
+    size_t train_rows = min(train_size, numObservations);
+    Fold split;
+    if (split_name != "first") {
+        split = splitRows(survived.data(), numObservations, numObservations - train_rows, split_name == "stratified", options.seed);
     }
-
-    // test data
-    int j = 0;
-    vector<vector<double>> test(2, vector<double>(survived.size()-800));
-    for (int i = 800; i < survived.size(); i++) {
-        test[0][j] = survived[i];
-        test[1][j] = sex[i];
-        j++;
+    RowView train = split_name == "first" ? RowView::range(features, 0, train_rows, true)
+        : RowView(features, split.train.data(), split.train.size(), true);
+    RowView test = split_name == "first" ? RowView::range(features, train_rows, numObservations, true)
+        : RowView(features, split.test.data(), split.test.size(), true);
+    Vector labels = gatherLabels(survived, train);
+
+    // cross-validation only needs the training data, and the folds are views of the same rows
+    if (cv_folds > 0) {
+        vector<string> solvers = splitList(grid_solvers.empty() ? solver_name : grid_solvers);
+        // the doubles themselves, not their text, so a small --lr or --l2 is not rounded away
+        vector<double> rates = numberList(grid_rates, options.learningRate);
+        vector<double> penalties = numberList(grid_penalties, options.l2);
+        return runCrossValidation(train, labels, cv_folds, stratify, solvers, rates, penalties, options, threads);
     }
 
-    // make the input data matrix for training
-    vector<vector<double>> data_matrix(2, vector<double>(train[0].size()));
-    for (int i = 0; i < train[0].size(); i++) {
-        data_matrix[0][i] = 1;
-        data_matrix[1][i] = sex[i];
+    // the same features with only the non-zero values stored, for --format sparse
+    SparseMatrix sparse_matrix;
+    if (format == "sparse") {
+        sparse_matrix = toSparse(train);
     }
 
     // get the current time before the algorithm starts
@@ -368,49 +382,61 @@ int main(int argc, char** argv) {
     start = system_clock().now();
 
     // calculate the weights (coefficients) of the logistic regression
-    vector<double> weights = logistic(data_matrix, train[0]);
+    SolverResult fit = format == "sparse"
+        ? logistic(sparse_matrix, labels, findSolver<SparseMatrix>(solver_name), options)
+        : logistic(train, labels, findSolver<RowView>(solver_name), options);
+    Vector& weights = fit.weights;
     // get the current time when the algorithm finished
     end = system_clock().now();
-    cout << "w0 = " << weights[0] << endl << "w1 = " << weights[1] << endl << endl;
+    cout << "w0 = " << weights[0] << endl << "w1 = " << weights[1] << endl;
+    cout << "iterations = " << fit.iterations << (fit.converged ? " (converged)" : " (not converged)") << endl << endl;
 
     // total time the algorithm ran
     duration<double> elapsed_time = end - start;
 
-    // make the input data matrix for testing
-    vector<vector<double>> test_matrix(2, vector<double>(test[0].size()));
-    for (int i = 0; i < test[0].size(); i++) {
-        test_matrix[0][i] = 1;
-        test_matrix[1][i] = test[1][i];
+    if (!save_path.empty()) {
+        string error;
+        if (!saveModel(weights, save_path, error)) {
+            cout << error << endl;
+            return 1;
+        }
+        cout << "Model saved to " << save_path << endl << endl;
     }
 
-    // get the predicted values and then round the probabilities
-    vector<double> predicted = predictValues(weights, test_matrix);
-    vector<double> predictions = roundProbs(predicted);
+    // get the predicted probabilities; a probability above 0.5 predicts survived
+    vector<double> predicted = format == "sparse" ? predictValues(weights, toSparse(test), options.sigmoidMode)
+        : predictValues(weights, test, options.sigmoidMode);
+    Vector test_labels = gatherLabels(survived, test);
 
     cout << "Metrics" << endl;
-    // get accuracy and output it
-    double acc = accuracy(predictions, test[0]);
-    cout << "accuracy = " << acc << endl;
+    // one pass over the probabilities gives the confusion matrix and the log-loss
+    BinaryMetrics metrics = evaluateMetrics(predicted.data(), test_labels.data(), predicted.size());
+    cout << "accuracy = " << metrics.accuracy() << endl;
 
-    // get sensitivity and specificity
-    double sensitive = sensitivity(predictions, test[0]);
-    double spec = specificity(predictions, test[0]);
+    // class 0 (perished) is the positive class, as in R's confusionMatrix
+    double sensitive = metrics.recall(0);
+    double spec = metrics.recall(1);
 
     // check that sensitivity and specificity are not undefined (NA)
-    if (sensitive == -1) {
+    if (isnan(sensitive)) {
         cout << "sensitivity = NA" << endl;
     }
     else {
         cout << "sensitivity = " << sensitive << endl;
     }
 
-    if (spec == -1) {
+    if (isnan(spec)) {
         cout << "specificity = NA" << endl;
     }
     else {
         cout << "specificity = " << spec << endl;
     }
 
+    // area under the ROC curve over every threshold
+    RocCurve roc = rocCurve(predicted.data(), test_labels.data(), predicted.size());
+    cout << "auc = " << roc.auc << endl;
+    cout << "log-loss = " << metrics.logLoss() << endl;
+
     // output the training time of the algorithm
     cout << "elapsed time (seconds) = " << elapsed_time.count() << endl;
 
@@ -0,0 +1,413 @@
+/*
+Module Name : Logistic Kernels
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Compute the gradient (and optionally the log-likelihood) of the logistic regression in a single
+pass over the data, without transposing the data matrix
+
+Module Design Description
+The rows are processed in blocks of LOGISTIC_BLOCK rows. For a block, z = Xw is built one
+column at a time (a contiguous loop over rows that the compiler vectorizes), then the sigmoid,
+the residual y - p and the log-likelihood are computed, and finally every column is dotted
+with the residuals using the SIMD kernel from Reduction.h. The block stays in cache between
+these steps, so X is read from memory once per evaluation. With a thread pool the blocks are
+split into one contiguous range per thread; each range adds into its own partial gradient and
+the partial gradients are added up in range order at the end.
+For Newton's method the same pass can also build the Hessian X^T W X (W = p(1 - p)), which is
+cheap when there are few columns.
+The sparse kernels do the same work touching only the non-zero values: the residuals come from
+the CSR rows (split into row ranges across threads), then every weight's gradient is gathered
+from its column of the CSC copy kept in the workspace (split into column ranges holding equal
+numbers of values), so no thread ever writes to another's gradient entries.
+The dense kernels also run on a RowView; the block's values of a column are then gathered
+into a small buffer first (or read in place for a range of rows), so the rest of the kernel is
+the same. A view's intercept column is a buffer of 1s, so it costs no memory traffic.
+*/
+
+#ifndef LOGISTIC_KERNELS_H
+#define LOGISTIC_KERNELS_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "Matrix.h"
+#include "SparseMatrix.h"
+#include "SigmoidKernels.h"
+#include "Reduction.h"
+#include "ThreadPool.h"
+
+// rows per block; small enough that the block's z and residuals stay in the L1 cache
+const size_t LOGISTIC_BLOCK = 256;
+// smallest number of rows worth giving their own thread
+const size_t MIN_LOGISTIC_ROWS = 1 << 14;
+
+// scratch space for the gradient, allocated once so evaluations do not allocate
+struct GradientWorkspace {
+    std::vector<Vector> partial;
+    std::vector<double> partialLoss;
+    // cols x cols per range, only allocated once a Hessian is asked for
+    std::vector<Vector> partialHessian;
+    size_t cols = 0;
+    int ranges = 0;
+    // how the sigmoid and its log are computed
+    SigmoidMode sigmoidMode = SIGMOID_EXACT;
+
+    GradientWorkspace(size_t rows, size_t cols, int threads) : cols(cols) {
+        ranges = (int)std::max((size_t)1, std::min((size_t)std::max(threads, 1), rows / MIN_LOGISTIC_ROWS));
+        partial.assign(ranges, Vector(cols));
+        partialLoss.assign(ranges, 0);
+    }
+
+    void ensureHessian() {
+        if (partialHessian.empty()) {
+            partialHessian.assign(ranges, Vector(cols * cols));
+        }
+    }
+};
+
+// column j of the rows [begin, begin + len) of a matrix: a pointer straight into it
+inline const double* blockColumn(const Matrix& x, size_t j, size_t begin, size_t /*len*/, double* /*buffer*/) {
+    return x.column(j) + begin;
+}
+
+// column j of the rows [begin, begin + len) of a view, gathered into buffer
+inline const double* blockColumn(const RowView& x, size_t j, size_t begin, size_t len, double* buffer) {
+    return x.gather(j, begin, len, buffer);
+}
+
+// column j of the rows rows[0..len) of a matrix, gathered into buffer
+inline const double* pickColumn(const Matrix& x, size_t j, const size_t* rows, size_t len, double* buffer) {
+    const double* col = x.column(j);
+    for (size_t r = 0; r < len; r++) {
+        buffer[r] = col[rows[r]];
+    }
+    return buffer;
+}
+
+// column j of the rows rows[0..len) of a view, gathered into buffer
+inline const double* pickColumn(const RowView& x, size_t j, const size_t* rows, size_t len, double* buffer) {
+    return x.gather(j, rows, len, buffer);
+}
+
+/* gradient of the log-likelihood, X^T (y - sigmoid(Xw)), for rows [begin, end)
+ * x = Matrix or RowView; y holds one label per row of x
+ * adds into gradient and returns the log-likelihood of those rows if wantLoss is set
+ * if hessian is not null, also adds the upper triangle of X^T W X into it (row-major cols x cols)
+ * mode = exact or fast sigmoid
+ */
+template <typename Data>
+double logisticRange(const Data& x, const Vector& y, const Vector& w, size_t begin, size_t end,
+    Vector& gradient, bool wantLoss, SigmoidMode mode, Vector* hessian = nullptr) {
+    double z[LOGISTIC_BLOCK];
+    double residual[LOGISTIC_BLOCK];
+    double weighted[LOGISTIC_BLOCK];
+    // room for gathering the columns of a view
+    double columnA[LOGISTIC_BLOCK];
+    double columnB[LOGISTIC_BLOCK];
+    double loss = 0;
+    size_t cols = x.cols();
+
+    for (size_t b = begin; b < end; b += LOGISTIC_BLOCK) {
+        size_t len = std::min(LOGISTIC_BLOCK, end - b);
+
+        // z = Xw for the block, one column at a time
+        std::fill(z, z + len, 0.0);
+        for (size_t j = 0; j < cols; j++) {
+            const double* col = blockColumn(x, j, b, len, columnA);
+            double wj = w[j];
+            for (size_t r = 0; r < len; r++) {
+                z[r] += col[r] * wj;
+            }
+        }
+
+        // residuals y - p and the log-likelihood y*z - log(1 + e^z) = y*z + log sigmoid(-z)
+        batchSigmoid(z, residual, len, mode);
+        for (size_t r = 0; r < len; r++) {
+            residual[r] = y[b + r] - residual[r];
+        }
+        if (wantLoss) {
+            for (size_t r = 0; r < len; r++) {
+                weighted[r] = -z[r];
+            }
+            batchLogSigmoid(weighted, weighted, len, mode);
+            for (size_t r = 0; r < len; r++) {
+                loss += y[b + r] * z[r] + weighted[r];
+            }
+        }
+
+        // X^T * residuals, without ever transposing X
+        for (size_t j = 0; j < cols; j++) {
+            gradient[j] += productSum(blockColumn(x, j, b, len, columnA), residual, len);
+        }
+
+        if (hessian != nullptr) {
+            // p is recovered from the residual, then X^T W X is built one column pair at a time
+            for (size_t j = 0; j < cols; j++) {
+                const double* col = blockColumn(x, j, b, len, columnA);
+                for (size_t r = 0; r < len; r++) {
+                    double p = y[b + r] - residual[r];
+                    weighted[r] = col[r] * p * (1 - p);
+                }
+                for (size_t k = j; k < cols; k++) {
+                    (*hessian)[j * cols + k] += productSum(weighted, blockColumn(x, k, b, len, columnB), len);
+                }
+            }
+        }
+    }
+    return loss;
+}
+
+/* gradient of the log-likelihood of the logistic regression at w, written into gradient
+ * returns the log-likelihood when wantLoss is set (otherwise 0)
+ * x = Matrix or RowView; y holds one label per row of x
+ * if hessian is not null it receives X^T W X (cols x cols, row-major), the negative Hessian
+ * pool may be null to run on the calling thread
+ */
+template <typename Data>
+double logisticGradient(const Data& x, const Vector& y, const Vector& w, Vector& gradient,
+    GradientWorkspace& workspace, ThreadPool* pool, bool wantLoss = false, Vector* hessian = nullptr) {
+    if (hessian != nullptr) {
+        workspace.ensureHessian();
+    }
+    size_t rows = x.rows();
+    int ranges = workspace.ranges;
+
+    auto task = [&](size_t t) {
+        // start every range on a block boundary so the blocks are the same for any range count
+        size_t blocks = (rows + LOGISTIC_BLOCK - 1) / LOGISTIC_BLOCK;
+        size_t begin = std::min(rows, blocks * t / ranges * LOGISTIC_BLOCK);
+        size_t end = std::min(rows, blocks * (t + 1) / ranges * LOGISTIC_BLOCK);
+        Vector& partial = workspace.partial[t];
+        std::fill(partial.data(), partial.data() + partial.size(), 0.0);
+        Vector* partialHessian = nullptr;
+        if (hessian != nullptr) {
+            partialHessian = &workspace.partialHessian[t];
+            std::fill(partialHessian->data(), partialHessian->data() + partialHessian->size(), 0.0);
+        }
+        workspace.partialLoss[t] = logisticRange(x, y, w, begin, end, partial, wantLoss, workspace.sigmoidMode, partialHessian);
+    };
+
+    if (pool != nullptr && ranges > 1) {
+        pool->run(ranges, task);
+    }
+    else {
+        for (int t = 0; t < ranges; t++) {
+            task(t);
+        }
+    }
+
+    // add up the partial results in range order
+    double loss = 0;
+    std::fill(gradient.data(), gradient.data() + gradient.size(), 0.0);
+    for (int t = 0; t < ranges; t++) {
+        gradient += workspace.partial[t];
+        loss += workspace.partialLoss[t];
+    }
+
+    if (hessian != nullptr) {
+        size_t cols = x.cols();
+        std::fill(hessian->data(), hessian->data() + hessian->size(), 0.0);
+        for (int t = 0; t < ranges; t++) {
+            *hessian += workspace.partialHessian[t];
+        }
+        // mirror the upper triangle
+        for (size_t j = 0; j < cols; j++) {
+            for (size_t k = 0; k < j; k++) {
+                (*hessian)[j * cols + k] = (*hessian)[k * cols + j];
+            }
+        }
+    }
+    return loss;
+}
+
+// the workspace for a dense data matrix
+inline GradientWorkspace makeWorkspace(const Matrix& x, int threads) {
+    return GradientWorkspace(x.rows(), x.cols(), threads);
+}
+
+// the workspace for a view of a dense data matrix
+inline GradientWorkspace makeWorkspace(const RowView& x, int threads) {
+    return GradientWorkspace(x.rows(), x.cols(), threads);
+}
+
+// scratch space for the sparse gradient, including the column (CSC) copy of the data
+struct SparseWorkspace {
+    SparseMatrix byColumn;
+    std::vector<double> residual;
+    std::vector<double> partialLoss;
+    std::vector<Vector> partialHessian;
+    size_t cols = 0;
+    int ranges = 0;
+    SigmoidMode sigmoidMode = SIGMOID_EXACT;
+
+    SparseWorkspace(const SparseMatrix& x, int threads) : byColumn(x.transpose()), residual(x.rows()), cols(x.cols()) {
+        ranges = (int)std::max((size_t)1, std::min((size_t)std::max(threads, 1), x.rows() / MIN_LOGISTIC_ROWS));
+        partialLoss.assign(ranges, 0);
+    }
+
+    void ensureHessian() {
+        if (partialHessian.empty()) {
+            partialHessian.assign(ranges, Vector(cols * cols));
+        }
+    }
+};
+
+// the workspace for a sparse data matrix
+inline SparseWorkspace makeWorkspace(const SparseMatrix& x, int threads) {
+    return SparseWorkspace(x, threads);
+}
+
+/* residuals y - sigmoid(Xw) of the sparse rows [begin, end) written into residual
+ * returns the log-likelihood of those rows if wantLoss is set; adds the upper triangle of
+ * X^T W X into hessian if it is not null
+ */
+inline double sparseLogisticRange(const SparseMatrix& x, const Vector& y, const Vector& w, size_t begin, size_t end,
+    double* residual, bool wantLoss, SigmoidMode mode, Vector* hessian) {
+    const uint32_t* columns = x.columnIndex();
+    const double* values = x.values();
+    size_t cols = x.cols();
+    double z[LOGISTIC_BLOCK];
+    double p[LOGISTIC_BLOCK];
+    double loss = 0;
+
+    for (size_t b = begin; b < end; b += LOGISTIC_BLOCK) {
+        size_t len = std::min(LOGISTIC_BLOCK, end - b);
+        for (size_t r = 0; r < len; r++) {
+            z[r] = x.rowDot(b + r, w.data());
+        }
+        batchSigmoid(z, p, len, mode);
+        if (wantLoss) {
+            // log sigmoid(-z) is built in the block's residual space before the residuals go there
+            double* logSigmoid = residual + b;
+            for (size_t r = 0; r < len; r++) {
+                logSigmoid[r] = -z[r];
+            }
+            batchLogSigmoid(logSigmoid, logSigmoid, len, mode);
+            for (size_t r = 0; r < len; r++) {
+                loss += y[b + r] * z[r] + logSigmoid[r];
+            }
+        }
+        for (size_t r = 0; r < len; r++) {
+            residual[b + r] = y[b + r] - p[r];
+        }
+
+        if (hessian != nullptr) {
+            // the row's values are sorted by column, so (a, c) with c after a is in the upper triangle
+            for (size_t r = 0; r < len; r++) {
+                size_t i = b + r;
+                double weight = p[r] * (1 - p[r]);
+                for (size_t a = x.rowBegin(i); a < x.rowEnd(i); a++) {
+                    double wa = weight * values[a];
+                    for (size_t c = a; c < x.rowEnd(i); c++) {
+                        (*hessian)[columns[a] * cols + columns[c]] += wa * values[c];
+                    }
+                }
+            }
+        }
+    }
+    return loss;
+}
+
+/* gradient of the log-likelihood for sparse data, touching only the non-zero values
+ * the arguments and result are the same as for the dense logisticGradient
+ */
+inline double logisticGradient(const SparseMatrix& x, const Vector& y, const Vector& w, Vector& gradient,
+    SparseWorkspace& workspace, ThreadPool* pool, bool wantLoss = false, Vector* hessian = nullptr) {
+    if (hessian != nullptr) {
+        workspace.ensureHessian();
+    }
+    size_t rows = x.rows();
+    size_t cols = x.cols();
+    int ranges = workspace.ranges;
+    auto runRanges = [&](const std::function<void(size_t)>& task) {
+        if (pool != nullptr && ranges > 1) {
+            pool->run(ranges, task);
+        }
+        else {
+            for (int t = 0; t < ranges; t++) {
+                task(t);
+            }
+        }
+    };
+
+    // residuals, one range of rows per thread
+    runRanges([&](size_t t) {
+        Vector* partialHessian = nullptr;
+        if (hessian != nullptr) {
+            partialHessian = &workspace.partialHessian[t];
+            std::fill(partialHessian->data(), partialHessian->data() + partialHessian->size(), 0.0);
+        }
+        workspace.partialLoss[t] = sparseLogisticRange(x, y, w, rows * t / ranges, rows * (t + 1) / ranges,
+            workspace.residual.data(), wantLoss, workspace.sigmoidMode, partialHessian);
+    });
+
+    // gradient[j] = column j . residuals, one range of columns per thread with about the same
+    // number of values in each
+    const SparseMatrix& byColumn = workspace.byColumn;
+    const size_t* starts = byColumn.rowStarts();
+    runRanges([&](size_t t) {
+        size_t first = std::upper_bound(starts, starts + cols + 1, byColumn.nonZeros() * t / ranges) - starts - 1;
+        size_t last = std::upper_bound(starts, starts + cols + 1, byColumn.nonZeros() * (t + 1) / ranges) - starts - 1;
+        // the ranges meet end to end, and together cover every column, including empty ones
+        if (t == 0) {
+            first = 0;
+        }
+        if (t + 1 == (size_t)ranges) {
+            last = cols;
+        }
+        for (size_t j = first; j < last; j++) {
+            gradient[j] = byColumn.rowDot(j, workspace.residual.data());
+        }
+    });
+
+    double loss = 0;
+    for (int t = 0; t < ranges; t++) {
+        loss += workspace.partialLoss[t];
+    }
+
+    if (hessian != nullptr) {
+        std::fill(hessian->data(), hessian->data() + hessian->size(), 0.0);
+        for (int t = 0; t < ranges; t++) {
+            *hessian += workspace.partialHessian[t];
+        }
+        for (size_t j = 0; j < cols; j++) {
+            for (size_t k = 0; k < j; k++) {
+                (*hessian)[j * cols + k] = (*hessian)[k * cols + j];
+            }
+        }
+    }
+    return loss;
+}
+
+/* probabilities sigmoid(Xw) written into probs (one per row) in one pass over the data
+ * x = Matrix or RowView; mode = exact or fast sigmoid
+ */
+template <typename Data>
+void logisticPredict(const Data& x, const Vector& w, double* probs, SigmoidMode mode = SIGMOID_EXACT) {
+    double buffer[LOGISTIC_BLOCK];
+    for (size_t b = 0; b < x.rows(); b += LOGISTIC_BLOCK) {
+        size_t len = std::min(LOGISTIC_BLOCK, x.rows() - b);
+        double* z = probs + b;
+        std::fill(z, z + len, 0.0);
+        for (size_t j = 0; j < x.cols(); j++) {
+            const double* col = blockColumn(x, j, b, len, buffer);
+            double wj = w[j];
+            for (size_t r = 0; r < len; r++) {
+                z[r] += col[r] * wj;
+            }
+        }
+        batchSigmoid(z, z, len, mode);
+    }
+}
+
+// probabilities sigmoid(Xw) for sparse data, written into probs (one per row)
+inline void logisticPredict(const SparseMatrix& x, const Vector& w, double* probs, SigmoidMode mode = SIGMOID_EXACT) {
+    for (size_t i = 0; i < x.rows(); i++) {
+        probs[i] = x.rowDot(i, w.data());
+    }
+    batchSigmoid(probs, probs, x.rows(), mode);
+}
+
+#endif
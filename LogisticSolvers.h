@@ -0,0 +1,684 @@
+/*
+Module Name : Logistic Solvers
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Fit the weights of the logistic regression, stopping as soon as the fit has converged instead
+of after a fixed number of iterations, with a choice of optimizer
+
+Module Design Description
+The full-batch solvers get the gradient (and the log-likelihood or Hessian when they need it)
+from the single-pass kernel in LogisticKernels.h. A solver stops when the largest gradient
+component, divided by the number of rows, falls below gradientTolerance, or when the
+log-likelihood changes by less than lossTolerance (relative) between checks, or after
+maxIterations. Gradient descent only asks for the log-likelihood every LOSS_CHECK_INTERVAL
+iterations since its steps are small. Newton's method (IRLS) solves (X^T W X) d = X^T (y - p)
+with a Cholesky factorization every iteration and halves the step if the log-likelihood would
+go down, so it converges in a handful of passes when there are few columns. For wide data
+(thousands of one-hot columns) the Hessian is too big, so L-BFGS keeps the last historySize
+steps and gradient changes in preallocated buffers, turns them into a search direction with
+the two-loop recursion, and picks the step length with a backtracking (Armijo) line search.
+For very many rows, mini-batch SGD shuffles the row order every epoch and takes a step after
+every batchSize rows, with the step size shrinking as learningRate / (1 + learningRateDecay *
+epoch). The Hogwild version splits every epoch's batches across threads that all update one
+shared weight vector with lock-free atomic adds and no other synchronization; each thread's
+scratch space sits on its own cache lines so the threads only ever share the weights. SGD
+stops when the log-likelihood summed over an epoch changes by less than epochTolerance. Every
+solver can add an L2 penalty l2/2 * |w|^2 on every weight but the intercept (column 0). The
+solvers all have the same signature and are looked up by name with findSolver, so logistic()
+does not need to know which one it is running. They are templates on the data type and work
+the same on a dense Matrix, a RowView of one (a split or a fold of cross-validation, with or
+without an implicit intercept column) or a SparseMatrix; the weights always get one entry per
+column of the data.
+*/
+
+#ifndef LOGISTIC_SOLVERS_H
+#define LOGISTIC_SOLVERS_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <numeric>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+#include "Matrix.h"
+#include "SparseMatrix.h"
+#include "LogisticKernels.h"
+#include "ThreadPool.h"
+
+// gradient descent iterations between two log-likelihood checks
+const int LOSS_CHECK_INTERVAL = 100;
+// most times a Newton step or line search step is halved before giving up
+const int MAX_STEP_HALVINGS = 30;
+// sufficient increase the line search asks of a step (Armijo constant)
+const double ARMIJO_FRACTION = 1e-4;
+
+struct SolverOptions {
+    int maxIterations = 50000;
+    // stop when max |gradient[j]| / rows is below this
+    double gradientTolerance = 1e-8;
+    // stop when the log-likelihood changes by less than this fraction between checks
+    double lossTolerance = 1e-12;
+    // gradient descent step size
+    double learningRate = 0.001;
+    // L2 penalty strength; 0 turns it off
+    double l2 = 0;
+    // steps remembered by L-BFGS
+    int historySize = 10;
+    // SGD: rows per step, passes over the data, and how the step size shrinks per epoch
+    int batchSize = 64;
+    int epochs = 1000;
+    bool shuffle = true;
+    double learningRateDecay = 0;
+    // SGD stops when the epoch's log-likelihood changes by less than this fraction
+    double epochTolerance = 1e-6;
+    // seed of the SGD row shuffle
+    unsigned long seed = 1;
+    // exact or fast (polynomial) sigmoid, see SigmoidKernels.h
+    SigmoidMode sigmoidMode = SIGMOID_EXACT;
+    int threads = 1;
+};
+
+struct SolverResult {
+    Vector weights;
+    int iterations = 0;
+    // passes over the data (gradient evaluations)
+    int passes = 0;
+    bool converged = false;
+    // log-likelihood minus the L2 penalty at the returned weights
+    double logLikelihood = 0;
+};
+
+/* log-likelihood minus l2/2 * |w|^2 (the intercept in column 0 is not penalized) and its gradient
+ * the arguments are the same as logisticGradient's; the penalty is added to the Hessian too
+ */
+template <typename Data, typename Workspace>
+double penalizedGradient(const Data& x, const Vector& y, const Vector& w, Vector& gradient,
+    Workspace& workspace, ThreadPool* pool, bool wantLoss, double l2, Vector* hessian = nullptr) {
+    double loss = logisticGradient(x, y, w, gradient, workspace, pool, wantLoss, hessian);
+    if (l2 == 0) {
+        return loss;
+    }
+    size_t cols = x.cols();
+    for (size_t j = 1; j < cols; j++) {
+        gradient[j] -= l2 * w[j];
+        loss -= 0.5 * l2 * w[j] * w[j];
+        if (hessian != nullptr) {
+            (*hessian)[j * cols + j] += l2;
+        }
+    }
+    return wantLoss ? loss : 0;
+}
+
+// largest gradient component divided by the number of rows
+inline double gradientSize(const Vector& gradient, size_t rows) {
+    double largest = 0;
+    for (size_t j = 0; j < gradient.size(); j++) {
+        largest = std::max(largest, std::fabs(gradient[j]));
+    }
+    return largest / std::max(rows, (size_t)1);
+}
+
+// true if the log-likelihood moved by less than tolerance (relative to its size)
+inline bool lossSettled(double previous, double current, double tolerance) {
+    return std::fabs(current - previous) <= tolerance * std::max(std::fabs(previous), 1.0);
+}
+
+/* solve a x = b for a symmetric positive definite n x n matrix (row-major)
+ * a is overwritten with its Cholesky factor; returns false if a is not positive definite
+ */
+inline bool choleskySolve(Vector& a, const Vector& b, Vector& x, size_t n) {
+    // a = L L^T, with L stored in the lower triangle of a
+    for (size_t j = 0; j < n; j++) {
+        double d = a[j * n + j];
+        for (size_t k = 0; k < j; k++) {
+            d -= a[j * n + k] * a[j * n + k];
+        }
+        if (!(d > 0)) {
+            return false;
+        }
+        d = std::sqrt(d);
+        a[j * n + j] = d;
+        for (size_t i = j + 1; i < n; i++) {
+            double s = a[i * n + j];
+            for (size_t k = 0; k < j; k++) {
+                s -= a[i * n + k] * a[j * n + k];
+            }
+            a[i * n + j] = s / d;
+        }
+    }
+
+    // L z = b, then L^T x = z
+    for (size_t i = 0; i < n; i++) {
+        double s = b[i];
+        for (size_t k = 0; k < i; k++) {
+            s -= a[i * n + k] * x[k];
+        }
+        x[i] = s / a[i * n + i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        double s = x[i];
+        for (size_t k = i + 1; k < n; k++) {
+            s -= a[k * n + i] * x[k];
+        }
+        x[i] = s / a[i * n + i];
+    }
+    return true;
+}
+
+/* gradient descent from weights of 1, with tolerance-based early exit
+ * x = one row per observation; y = labels (0 or 1)
+ */
+template <typename Data>
+SolverResult gradientDescent(const Data& x, const Vector& y, const SolverOptions& options) {
+    SolverResult result;
+    result.weights = Vector(x.cols(), 1);
+    Vector& weights = result.weights;
+
+    // allocated once; the loop below does not allocate anything
+    Vector gradient(x.cols());
+    auto workspace = makeWorkspace(x, options.threads);
+    workspace.sigmoidMode = options.sigmoidMode;
+    ThreadPool pool(workspace.ranges);
+
+    double previousLoss = 0;
+    bool haveLoss = false;
+    for (int i = 1; i <= options.maxIterations; i++) {
+        // the log-likelihood costs a log per row, so only compute it every so often
+        bool checkLoss = i % LOSS_CHECK_INTERVAL == 0;
+        double loss = penalizedGradient(x, y, weights, gradient, workspace, &pool, checkLoss, options.l2);
+        result.iterations = i;
+        result.passes = i;
+
+        if (gradientSize(gradient, x.rows()) < options.gradientTolerance) {
+            result.converged = true;
+            break;
+        }
+        if (checkLoss) {
+            result.logLikelihood = loss;
+            if (haveLoss && lossSettled(previousLoss, loss, options.lossTolerance)) {
+                result.converged = true;
+                break;
+            }
+            previousLoss = loss;
+            haveLoss = true;
+        }
+
+        // calculate new weights
+        weights += options.learningRate * gradient;
+    }
+    return result;
+}
+
+/* Newton's method (iteratively reweighted least squares) from weights of 0
+ * x = one row per observation; y = labels (0 or 1)
+ * stops early without converging if X^T W X becomes singular (e.g. separable data)
+ */
+template <typename Data>
+SolverResult newtonSolve(const Data& x, const Vector& y, const SolverOptions& options) {
+    size_t cols = x.cols();
+    SolverResult result;
+    result.weights = Vector(cols, 0);
+    Vector& weights = result.weights;
+
+    Vector gradient(cols);
+    Vector hessian(cols * cols);
+    Vector factor(cols * cols);
+    Vector step(cols);
+    Vector candidate(cols);
+    auto workspace = makeWorkspace(x, options.threads);
+    workspace.sigmoidMode = options.sigmoidMode;
+    ThreadPool pool(workspace.ranges);
+
+    double loss = penalizedGradient(x, y, weights, gradient, workspace, &pool, true, options.l2, &hessian);
+    result.passes = 1;
+    for (int i = 1; i <= options.maxIterations; i++) {
+        if (gradientSize(gradient, x.rows()) < options.gradientTolerance) {
+            result.converged = true;
+            break;
+        }
+
+        // (X^T W X) step = X^T (y - p)
+        factor = hessian;
+        if (!choleskySolve(factor, gradient, step, cols)) {
+            break;
+        }
+
+        // take the full step unless it lowers the log-likelihood; then halve it until it does not
+        // the evaluation at the accepted point also gives the next gradient and Hessian
+        double scale = 1;
+        double newLoss = loss;
+        bool improved = false;
+        for (int h = 0; h <= MAX_STEP_HALVINGS && !improved; h++) {
+            candidate = weights + scale * step;
+            newLoss = penalizedGradient(x, y, candidate, gradient, workspace, &pool, true, options.l2, &hessian);
+            result.passes++;
+            improved = newLoss >= loss;
+            scale /= 2;
+        }
+        if (!improved) {
+            // no step helps; put back the gradient and Hessian of the current weights
+            penalizedGradient(x, y, weights, gradient, workspace, &pool, true, options.l2, &hessian);
+            result.passes++;
+            break;
+        }
+
+        std::swap(weights, candidate);
+        result.iterations = i;
+        bool settled = lossSettled(loss, newLoss, options.lossTolerance);
+        loss = newLoss;
+        if (settled) {
+            result.converged = true;
+            break;
+        }
+    }
+    result.logLikelihood = loss;
+    return result;
+}
+
+// dot product of two vectors
+inline double dot(const Vector& a, const Vector& b) {
+    return productSum(a.data(), b.data(), a.size());
+}
+
+inline double dot(const double* a, const Vector& b) {
+    return productSum(a, b.data(), b.size());
+}
+
+/* L-BFGS from weights of 0, maximizing the (penalized) log-likelihood
+ * x = one row per observation; y = labels (0 or 1)
+ */
+template <typename Data>
+SolverResult lbfgsSolve(const Data& x, const Vector& y, const SolverOptions& options) {
+    size_t cols = x.cols();
+    size_t memory = (size_t)std::max(options.historySize, 1);
+    SolverResult result;
+    result.weights = Vector(cols, 0);
+    Vector& weights = result.weights;
+
+    // history of steps s = w' - w and gradient changes t = g' - g (of the function being
+    // minimized, -log-likelihood); column k % memory holds step k
+    Matrix steps(cols, memory);
+    Matrix changes(cols, memory);
+    Vector rho(memory);
+    Vector alpha(memory);
+    size_t stored = 0;
+    size_t newest = 0;
+
+    Vector gradient(cols);
+    Vector newGradient(cols);
+    Vector direction(cols);
+    Vector candidate(cols);
+    // the newest step and gradient change, only copied into the history once they are kept
+    Vector newStep(cols);
+    Vector newChange(cols);
+    auto workspace = makeWorkspace(x, options.threads);
+    workspace.sigmoidMode = options.sigmoidMode;
+    ThreadPool pool(workspace.ranges);
+
+    // the kernel gives the gradient of the log-likelihood; the descent direction of
+    // -log-likelihood is therefore +H * gradient
+    double loss = penalizedGradient(x, y, weights, gradient, workspace, &pool, true, options.l2);
+    result.passes = 1;
+    for (int i = 1; i <= options.maxIterations; i++) {
+        if (gradientSize(gradient, x.rows()) < options.gradientTolerance) {
+            result.converged = true;
+            break;
+        }
+
+        // two-loop recursion: direction = H * gradient, newest step first
+        direction = gradient;
+        for (size_t k = 0; k < stored; k++) {
+            size_t c = (newest + memory - k) % memory;
+            alpha[c] = rho[c] * dot(steps.column(c), direction);
+            for (size_t j = 0; j < cols; j++) {
+                direction[j] -= alpha[c] * changes(j, c);
+            }
+        }
+        if (stored > 0) {
+            // start from the scaled identity s^T t / t^T t of the newest pair
+            const double* s = steps.column(newest);
+            const double* t = changes.column(newest);
+            double scale = productSum(s, t, cols) / productSum(t, t, cols);
+            for (size_t j = 0; j < cols; j++) {
+                direction[j] *= scale;
+            }
+        }
+        for (size_t k = stored; k-- > 0;) {
+            size_t c = (newest + memory - k) % memory;
+            double beta = rho[c] * dot(changes.column(c), direction);
+            for (size_t j = 0; j < cols; j++) {
+                direction[j] += (alpha[c] - beta) * steps(j, c);
+            }
+        }
+
+        double slope = dot(gradient, direction);
+        if (!(slope > 0)) {
+            // not an ascent direction (bad curvature history); restart from the gradient
+            direction = gradient;
+            slope = dot(gradient, gradient);
+            stored = 0;
+        }
+        // a step without curvature information (the first one, or after a restart) is kept short
+        double step = stored > 0 ? 1 : 1 / std::max(std::sqrt(dot(gradient, gradient)), 1.0);
+
+        // backtracking line search until the log-likelihood rises enough
+        double newLoss = loss;
+        bool accepted = false;
+        for (int h = 0; h <= MAX_STEP_HALVINGS && !accepted; h++) {
+            candidate = weights + step * direction;
+            newLoss = penalizedGradient(x, y, candidate, newGradient, workspace, &pool, true, options.l2);
+            result.passes++;
+            accepted = newLoss >= loss + ARMIJO_FRACTION * step * slope;
+            if (!accepted) {
+                step /= 2;
+            }
+        }
+        if (!accepted) {
+            break;
+        }
+
+        /* remember the step, skipping it if the curvature is not positive; it only replaces the
+         * oldest pair of a full history once it is kept
+         */
+        for (size_t j = 0; j < cols; j++) {
+            newStep[j] = candidate[j] - weights[j];
+            newChange[j] = gradient[j] - newGradient[j];
+        }
+        double curvature = productSum(newStep.data(), newChange.data(), cols);
+        if (curvature > 1e-10 * productSum(newChange.data(), newChange.data(), cols)) {
+            size_t c = stored == 0 ? 0 : (newest + 1) % memory;
+            std::copy(newStep.data(), newStep.data() + cols, steps.column(c));
+            std::copy(newChange.data(), newChange.data() + cols, changes.column(c));
+            rho[c] = 1 / curvature;
+            newest = c;
+            stored = std::min(stored + 1, memory);
+        }
+
+        std::swap(weights, candidate);
+        std::swap(gradient, newGradient);
+        result.iterations = i;
+        bool settled = lossSettled(loss, newLoss, options.lossTolerance);
+        loss = newLoss;
+        if (settled) {
+            result.converged = true;
+            break;
+        }
+    }
+    result.logLikelihood = loss;
+    return result;
+}
+
+// allocator that starts every block on a cache line and rounds its size up to whole lines, so
+// blocks owned by different threads never share a line
+template <typename T>
+struct CacheLineAllocator {
+    using value_type = T;
+
+    CacheLineAllocator() = default;
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+        return (T*)::operator new(bytes, std::align_val_t(MATRIX_ALIGNMENT));
+    }
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(MATRIX_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const CacheLineAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheLineAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using PaddedVector = std::vector<T, CacheLineAllocator<T>>;
+
+// per-thread SGD scratch; the struct and every buffer it owns sit on whole cache lines of their
+// own, so no two threads ever write to the same line
+struct alignas(MATRIX_ALIGNMENT) SgdScratch {
+    PaddedVector<double> weights;
+    PaddedVector<double> z;
+    PaddedVector<double> residual;
+    // dense data only: one column of the batch
+    PaddedVector<double> column;
+    // sparse data only: the batch gradient and the columns the batch touched
+    PaddedVector<double> gradient;
+    PaddedVector<uint8_t> marked;
+    PaddedVector<uint32_t> touched;
+    double loss = 0;
+};
+
+// lock-free target += value
+inline void atomicAdd(std::atomic<double>& target, double value) {
+    double old = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(old, old + value, std::memory_order_relaxed)) {
+    }
+}
+
+// turn scratch.z of the batch rows into residuals y - p, adding their log-likelihood to scratch.loss
+inline void sgdResiduals(const Vector& y, const size_t* rows, size_t len, SigmoidMode mode, SgdScratch& scratch) {
+    double* z = scratch.z.data();
+    double* residual = scratch.residual.data();
+
+    // y*z + log sigmoid(-z), built in the residual space before the residuals go there
+    for (size_t r = 0; r < len; r++) {
+        residual[r] = -z[r];
+    }
+    batchLogSigmoid(residual, residual, len, mode);
+    for (size_t r = 0; r < len; r++) {
+        scratch.loss += y[rows[r]] * z[r] + residual[r];
+    }
+
+    batchSigmoid(z, residual, len, mode);
+    for (size_t r = 0; r < len; r++) {
+        residual[r] = y[rows[r]] - residual[r];
+    }
+}
+
+/* one SGD step on the rows rows[0..len) against the shared weights
+ * x = Matrix or RowView; rate = step size; penalty = L2 strength for this batch's share of the data
+ */
+template <typename Data>
+void sgdBatch(const Data& x, const Vector& y, const size_t* rows, size_t len,
+    std::vector<std::atomic<double>>& shared, double rate, double penalty, SigmoidMode mode, SgdScratch& scratch) {
+    size_t cols = x.cols();
+    double* column = scratch.column.data();
+
+    // Hogwild: read the weights once per batch without locking; they may be slightly stale
+    for (size_t j = 0; j < cols; j++) {
+        scratch.weights[j] = shared[j].load(std::memory_order_relaxed);
+    }
+
+    // z = Xw for the batch, one column at a time
+    std::fill(scratch.z.begin(), scratch.z.begin() + len, 0.0);
+    for (size_t j = 0; j < cols; j++) {
+        const double* col = pickColumn(x, j, rows, len, column);
+        double wj = scratch.weights[j];
+        for (size_t r = 0; r < len; r++) {
+            scratch.z[r] += col[r] * wj;
+        }
+    }
+    sgdResiduals(y, rows, len, mode, scratch);
+
+    // gradient of the batch, added straight into the shared weights
+    for (size_t j = 0; j < cols; j++) {
+        const double* col = pickColumn(x, j, rows, len, column);
+        double g = 0;
+        for (size_t r = 0; r < len; r++) {
+            g += col[r] * scratch.residual[r];
+        }
+        if (j > 0) {
+            g -= penalty * scratch.weights[j];
+        }
+        // columns that are zero for the whole batch (one-hot data) are not touched
+        if (g != 0) {
+            atomicAdd(shared[j], rate * g);
+        }
+    }
+}
+
+/* sparse version of sgdBatch; only the weights of the columns the batch touches are read and
+ * updated, and the L2 penalty is only applied to those columns
+ */
+inline void sgdBatch(const SparseMatrix& x, const Vector& y, const size_t* rows, size_t len,
+    std::vector<std::atomic<double>>& shared, double rate, double penalty, SigmoidMode mode, SgdScratch& scratch) {
+    const uint32_t* columns = x.columnIndex();
+    const double* values = x.values();
+
+    for (size_t r = 0; r < len; r++) {
+        size_t i = rows[r];
+        double z = 0;
+        for (size_t k = x.rowBegin(i); k < x.rowEnd(i); k++) {
+            z += values[k] * shared[columns[k]].load(std::memory_order_relaxed);
+        }
+        scratch.z[r] = z;
+    }
+    sgdResiduals(y, rows, len, mode, scratch);
+
+    for (size_t r = 0; r < len; r++) {
+        size_t i = rows[r];
+        double residual = scratch.residual[r];
+        for (size_t k = x.rowBegin(i); k < x.rowEnd(i); k++) {
+            uint32_t c = columns[k];
+            if (!scratch.marked[c]) {
+                scratch.marked[c] = 1;
+                scratch.touched.push_back(c);
+            }
+            scratch.gradient[c] += values[k] * residual;
+        }
+    }
+
+    for (uint32_t c : scratch.touched) {
+        double g = scratch.gradient[c];
+        if (c > 0) {
+            g -= penalty * shared[c].load(std::memory_order_relaxed);
+        }
+        atomicAdd(shared[c], rate * g);
+        scratch.gradient[c] = 0;
+        scratch.marked[c] = 0;
+    }
+    scratch.touched.clear();
+}
+
+/* mini-batch SGD from weights of 0 with workers threads updating the same weights (Hogwild)
+ * x = one row per observation; y = labels (0 or 1); an iteration is one epoch
+ */
+template <typename Data>
+SolverResult sgdEpochs(const Data& x, const Vector& y, const SolverOptions& options, int workers) {
+    size_t rows = x.rows();
+    size_t cols = x.cols();
+    size_t batch = (size_t)std::max(options.batchSize, 1);
+    size_t batches = (rows + batch - 1) / batch;
+    workers = (int)std::max((size_t)1, std::min((size_t)std::max(workers, 1), batches));
+
+    std::vector<std::atomic<double>> shared(cols);
+    for (size_t j = 0; j < cols; j++) {
+        shared[j].store(0);
+    }
+    std::vector<SgdScratch> scratch(workers);
+    for (SgdScratch& s : scratch) {
+        s.weights.assign(cols, 0);
+        s.z.assign(batch, 0);
+        s.residual.assign(batch, 0);
+        if (std::is_same<Data, SparseMatrix>::value) {
+            s.gradient.assign(cols, 0);
+            s.marked.assign(cols, 0);
+        }
+        else {
+            s.column.assign(batch, 0);
+        }
+    }
+    std::vector<size_t> order(rows);
+    std::iota(order.begin(), order.end(), (size_t)0);
+    std::mt19937_64 random(options.seed);
+    ThreadPool pool(workers);
+
+    SolverResult result;
+    double previousLoss = 0;
+    for (int epoch = 1; epoch <= options.epochs; epoch++) {
+        if (options.shuffle) {
+            std::shuffle(order.begin(), order.end(), random);
+        }
+        double rate = options.learningRate / (1 + options.learningRateDecay * (epoch - 1));
+
+        // every thread takes a contiguous range of the epoch's batches
+        pool.run(workers, [&](size_t t) {
+            SgdScratch& s = scratch[t];
+            s.loss = 0;
+            for (size_t b = batches * t / workers; b < batches * (t + 1) / workers; b++) {
+                size_t begin = b * batch;
+                size_t len = std::min(batch, rows - begin);
+                sgdBatch(x, y, order.data() + begin, len, shared, rate, options.l2 * len / rows, options.sigmoidMode, s);
+            }
+        });
+
+        double loss = 0;
+        for (const SgdScratch& s : scratch) {
+            loss += s.loss;
+        }
+        result.iterations = epoch;
+        result.passes = epoch;
+        result.logLikelihood = loss;
+        if (epoch > 1 && lossSettled(previousLoss, loss, options.epochTolerance)) {
+            result.converged = true;
+            break;
+        }
+        previousLoss = loss;
+    }
+
+    result.weights = Vector(cols);
+    for (size_t j = 0; j < cols; j++) {
+        result.weights[j] = shared[j].load();
+    }
+    return result;
+}
+
+// mini-batch SGD on the calling thread
+template <typename Data>
+SolverResult sgdSolve(const Data& x, const Vector& y, const SolverOptions& options) {
+    return sgdEpochs(x, y, options, 1);
+}
+
+// mini-batch SGD with options.threads threads sharing the weights without locks
+template <typename Data>
+SolverResult hogwildSolve(const Data& x, const Vector& y, const SolverOptions& options) {
+    return sgdEpochs(x, y, options, options.threads);
+}
+
+// every solver has this signature
+template <typename Data>
+using LogisticSolver = SolverResult (*)(const Data& x, const Vector& y, const SolverOptions& options);
+
+template <typename Data>
+struct SolverEntry {
+    const char* name;
+    LogisticSolver<Data> solve;
+};
+
+// the solver with this name for Data (Matrix, RowView or SparseMatrix), or nullptr if there is none
+template <typename Data>
+LogisticSolver<Data> findSolver(const std::string& name) {
+    // the available solvers, by the name used on the command line
+    static const SolverEntry<Data> solvers[] = {
+        { "newton", newtonSolve<Data> },
+        { "gd", gradientDescent<Data> },
+        { "lbfgs", lbfgsSolve<Data> },
+        { "sgd", sgdSolve<Data> },
+        { "hogwild", hogwildSolve<Data> },
+    };
+    for (const SolverEntry<Data>& entry : solvers) {
+        if (name == entry.name) {
+            return entry.solve;
+        }
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+Module Name : Mapped File
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Give the readers read-only access to a whole file without copying it through a stream
+
+Module Design Description
+MappedFile memory-maps a file (mmap on POSIX systems) and exposes its bytes as one contiguous
+range that stays valid until the object is closed or destroyed. On Windows it falls back to
+reading the file into a buffer once, so the callers do not need to care which one they got.
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    // map the file at path; returns false if it could not be opened
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) {
+            return false;
+        }
+        buffer.resize((size_t)in.tellg());
+        in.seekg(0);
+        in.read(buffer.data(), buffer.size());
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            // the readers walk the file front to back
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            bytes = (const char*)mapped;
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    void close() {
+#if defined(_WIN32)
+        buffer.clear();
+#else
+        if (bytes != nullptr) {
+            munmap((void*)bytes, length);
+        }
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    std::vector<char> buffer;
+#endif
+};
+
+#endif
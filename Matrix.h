@@ -0,0 +1,295 @@
+/*
+Module Name : Matrix
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Store the data and weights of the logistic regression in contiguous memory and evaluate whole
+formulas on them without creating a new vector for every step
+
+Module Design Description
+Vector and Matrix own one 64-byte aligned block of doubles. Matrix is column-major and pads
+every column to a multiple of 8 values, so each column starts on a 64-byte boundary. Sums and
+scalar multiples of vectors build expression objects instead of results (expression
+templates): a + s * b is a small object that knows how to compute element i, and assigning it
+to a Vector, or adding it with +=, runs a single loop with no temporary vectors. This is what
+the solvers use to take a step. Expressions hold references to their operands, so they have
+to be assigned in the same statement that builds them. The gradient, log-likelihood and
+Hessian are not expressions; they come from the fused kernels in LogisticKernels.h. RowView
+picks a subset of the rows of a Matrix, either a range of them or a list of row numbers, so
+folds and splits of one data set can be trained on without copying it. A view can also put an
+intercept column of 1s in front of the matrix's columns; it is never stored, the 1s are only
+written into the small buffers the kernels read through.
+*/
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+#include <new>
+#include <algorithm>
+#include <initializer_list>
+
+const size_t MATRIX_ALIGNMENT = 64;
+
+// allocate n doubles on a 64-byte boundary, set to fill
+inline double* allocateAligned(size_t n, double fill) {
+    if (n == 0) {
+        return nullptr;
+    }
+    double* p = (double*)::operator new(n * sizeof(double), std::align_val_t(MATRIX_ALIGNMENT));
+    std::fill(p, p + n, fill);
+    return p;
+}
+
+inline void freeAligned(double* p) {
+    if (p != nullptr) {
+        ::operator delete(p, std::align_val_t(MATRIX_ALIGNMENT));
+    }
+}
+
+// base of every vector expression; E is the expression type itself
+template <typename E>
+struct VecExpr {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+class Vector : public VecExpr<Vector> {
+public:
+    explicit Vector(size_t n = 0, double fill = 0) : values(allocateAligned(n, fill)), n(n) {}
+
+    Vector(std::initializer_list<double> init) : values(allocateAligned(init.size(), 0)), n(init.size()) {
+        std::copy(init.begin(), init.end(), values);
+    }
+
+    Vector(const Vector& other) : values(allocateAligned(other.n, 0)), n(other.n) {
+        std::copy(other.values, other.values + n, values);
+    }
+
+    Vector(Vector&& other) noexcept : values(other.values), n(other.n) {
+        other.values = nullptr;
+        other.n = 0;
+    }
+
+    // build a vector from an expression
+    template <typename E>
+    Vector(const VecExpr<E>& e) : values(allocateAligned(e.self().size(), 0)), n(e.self().size()) {
+        assign(e.self());
+    }
+
+    ~Vector() {
+        freeAligned(values);
+    }
+
+    Vector& operator=(const Vector& other) {
+        if (this != &other) {
+            resize(other.n);
+            std::copy(other.values, other.values + n, values);
+        }
+        return *this;
+    }
+
+    Vector& operator=(Vector&& other) noexcept {
+        std::swap(values, other.values);
+        std::swap(n, other.n);
+        return *this;
+    }
+
+    // evaluate an expression into this vector in one loop; the sizes must already match
+    template <typename E>
+    Vector& operator=(const VecExpr<E>& e) {
+        assign(e.self());
+        return *this;
+    }
+
+    template <typename E>
+    Vector& operator+=(const VecExpr<E>& e) {
+        const E& expr = e.self();
+        for (size_t i = 0; i < n; i++) {
+            values[i] += expr[i];
+        }
+        return *this;
+    }
+
+    // change the size; the values are lost if the size changes
+    void resize(size_t size) {
+        if (size != n) {
+            freeAligned(values);
+            values = allocateAligned(size, 0);
+            n = size;
+        }
+    }
+
+    double operator[](size_t i) const { return values[i]; }
+    double& operator[](size_t i) { return values[i]; }
+    size_t size() const { return n; }
+    double* data() { return values; }
+    const double* data() const { return values; }
+    const double* begin() const { return values; }
+    const double* end() const { return values + n; }
+
+private:
+    double* values;
+    size_t n;
+
+    template <typename E>
+    void assign(const E& expr) {
+        for (size_t i = 0; i < n; i++) {
+            values[i] = expr[i];
+        }
+    }
+};
+
+// column-major rows x cols matrix
+class Matrix {
+public:
+    explicit Matrix(size_t rows = 0, size_t cols = 0, double fill = 0)
+        : values(allocateAligned(paddedRows(rows) * cols, fill)), nRows(rows), nCols(cols), stride(paddedRows(rows)) {}
+
+    Matrix(const Matrix& other)
+        : values(allocateAligned(other.stride * other.nCols, 0)), nRows(other.nRows), nCols(other.nCols), stride(other.stride) {
+        std::copy(other.values, other.values + stride * nCols, values);
+    }
+
+    Matrix(Matrix&& other) noexcept : values(other.values), nRows(other.nRows), nCols(other.nCols), stride(other.stride) {
+        other.values = nullptr;
+        other.nRows = other.nCols = other.stride = 0;
+    }
+
+    Matrix& operator=(Matrix other) {
+        std::swap(values, other.values);
+        std::swap(nRows, other.nRows);
+        std::swap(nCols, other.nCols);
+        std::swap(stride, other.stride);
+        return *this;
+    }
+
+    ~Matrix() {
+        freeAligned(values);
+    }
+
+    double operator()(size_t i, size_t j) const { return values[j * stride + i]; }
+    double& operator()(size_t i, size_t j) { return values[j * stride + i]; }
+
+    // start of column j; the column holds rows() values
+    const double* column(size_t j) const { return values + j * stride; }
+    double* column(size_t j) { return values + j * stride; }
+
+    size_t rows() const { return nRows; }
+    size_t cols() const { return nCols; }
+
+private:
+    double* values;
+    size_t nRows;
+    size_t nCols;
+    // distance between the starts of two columns, rows rounded up to a multiple of 8
+    size_t stride;
+
+    static size_t paddedRows(size_t rows) {
+        size_t perLine = MATRIX_ALIGNMENT / sizeof(double);
+        return (rows + perLine - 1) / perLine * perLine;
+    }
+};
+
+/* some of the rows of a matrix without copying them: the rows index[0..n) in that order, or
+ * the rows [first, first + n) if index is null
+ * with intercept set, column 0 of the view is all 1s and column j is column j - 1 of the matrix
+ */
+class RowView {
+public:
+    RowView(const Matrix& x, const size_t* index, size_t n, bool intercept = false)
+        : x(&x), index(index), first(0), n(n), intercept(intercept) {}
+
+    // the rows [begin, end) of x
+    static RowView range(const Matrix& x, size_t begin, size_t end, bool intercept = false) {
+        RowView view(x, nullptr, end - begin, intercept);
+        view.first = begin;
+        return view;
+    }
+
+    size_t rows() const { return n; }
+    size_t cols() const { return x->cols() + hasIntercept(); }
+    // row of the matrix that row r of the view is
+    size_t row(size_t r) const { return index != nullptr ? index[r] : first + r; }
+    const Matrix& matrix() const { return *x; }
+    bool hasIntercept() const { return intercept; }
+
+    /* column j of the view's rows [begin, begin + len); a range of the matrix is read in place,
+     * anything else is copied into buffer
+     */
+    const double* gather(size_t j, size_t begin, size_t len, double* buffer) const {
+        if (intercept && j == 0) {
+            std::fill(buffer, buffer + len, 1.0);
+            return buffer;
+        }
+        const double* col = x->column(j - intercept);
+        if (index == nullptr) {
+            return col + first + begin;
+        }
+        for (size_t r = 0; r < len; r++) {
+            buffer[r] = col[index[begin + r]];
+        }
+        return buffer;
+    }
+
+    // column j of the view's rows rows[0..len), copied into buffer
+    const double* gather(size_t j, const size_t* rows, size_t len, double* buffer) const {
+        if (intercept && j == 0) {
+            std::fill(buffer, buffer + len, 1.0);
+            return buffer;
+        }
+        const double* col = x->column(j - intercept);
+        for (size_t r = 0; r < len; r++) {
+            buffer[r] = col[row(rows[r])];
+        }
+        return buffer;
+    }
+
+private:
+    const Matrix* x;
+    const size_t* index;
+    size_t first;
+    size_t n;
+    bool intercept;
+};
+
+// element-wise operation on two expressions
+template <typename L, typename R, typename Op>
+struct VecBinary : VecExpr<VecBinary<L, R, Op>> {
+    const L& l;
+    const R& r;
+    VecBinary(const L& l, const R& r) : l(l), r(r) {}
+    double operator[](size_t i) const { return Op::apply(l[i], r[i]); }
+    size_t size() const { return l.size(); }
+};
+
+// scalar times an expression
+template <typename E>
+struct VecScaled : VecExpr<VecScaled<E>> {
+    double s;
+    const E& e;
+    VecScaled(double s, const E& e) : s(s), e(e) {}
+    double operator[](size_t i) const { return s * e[i]; }
+    size_t size() const { return e.size(); }
+};
+
+struct AddOp {
+    static double apply(double a, double b) { return a + b; }
+};
+
+template <typename L, typename R>
+VecBinary<L, R, AddOp> operator+(const VecExpr<L>& l, const VecExpr<R>& r) {
+    return VecBinary<L, R, AddOp>(l.self(), r.self());
+}
+
+template <typename E>
+VecScaled<E> operator*(double s, const VecExpr<E>& e) {
+    return VecScaled<E>(s, e.self());
+}
+
+template <typename E>
+VecScaled<E> operator*(const VecExpr<E>& e, double s) {
+    return VecScaled<E>(s, e.self());
+}
+
+#endif
@@ -0,0 +1,266 @@
+/*
+Module Name : Metrics
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Score the predicted probabilities of a binary classifier against the true labels: the
+confusion matrix at a threshold, accuracy, sensitivity, specificity, log-loss, and the ROC and
+precision/recall curves over every threshold with the area under the ROC curve
+
+Module Design Description
+evaluateMetrics reads the probabilities and labels once and fills a BinaryMetrics: the 2x2
+confusion matrix (a probability above the threshold predicts 1) and the summed log-loss, with
+the probabilities clamped away from 0 and 1 so a confident mistake costs a large but finite
+amount. Nothing is rounded or copied first. Large inputs are cut into blocks that are counted
+on separate threads and merged in block order, so the result does not depend on the thread
+count. recall(c) is the share of rows of class c that were predicted c, so with class 0 taken
+as the positive class (as R's confusionMatrix does) sensitivity is recall(0) and specificity
+is recall(1).
+The curves need the rows ordered by probability. rocCurve sorts the (probability, label)
+pairs once, from the highest probability down, and walks them: every distinct probability is
+a threshold, and the positives and negatives above it give one point of the ROC curve (false
+positive rate, true positive rate) and the precision/recall curve, taking label 1 as the
+positive class. The AUC is the trapezoid area under the ROC points, which counts tied
+probabilities as half right, and the average precision is the precision at every point
+weighted by the recall it adds. For inputs too large to sort, ScoreHistogram counts the
+positives and negatives in equal-width probability bins in one streaming pass (bins from
+separate threads or separate runs can be merged) and rocCurve of a histogram walks the bins
+from the top the same way, so its thresholds are the bin edges and its AUC is exact up to
+ties within a bin.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include "Reduction.h"
+#include "ThreadPool.h"
+
+// probabilities are kept this far from 0 and 1 so the log-loss stays finite
+const double PROBABILITY_FLOOR = 1e-15;
+// default number of bins of a ScoreHistogram
+const size_t SCORE_HISTOGRAM_BINS = 1 << 12;
+
+// the confusion matrix and log-loss of a set of predictions
+struct BinaryMetrics {
+    // counts[actual][predicted]
+    size_t counts[2][2] = { { 0, 0 }, { 0, 0 } };
+    double logLossSum = 0;
+
+    // add one row: p = predicted probability of class 1, label = 0 or 1
+    void add(double p, double label, double threshold) {
+        int actual = label == 1;
+        counts[actual][p > threshold]++;
+        p = std::min(std::max(p, PROBABILITY_FLOOR), 1 - PROBABILITY_FLOOR);
+        logLossSum -= actual ? std::log(p) : std::log(1 - p);
+    }
+
+    void merge(const BinaryMetrics& other) {
+        for (int a = 0; a < 2; a++) {
+            for (int p = 0; p < 2; p++) {
+                counts[a][p] += other.counts[a][p];
+            }
+        }
+        logLossSum += other.logLossSum;
+    }
+
+    size_t total() const { return counts[0][0] + counts[0][1] + counts[1][0] + counts[1][1]; }
+
+    double accuracy() const {
+        return total() == 0 ? NAN : (double)(counts[0][0] + counts[1][1]) / total();
+    }
+
+    // share of the rows of class c predicted as c; nan if there are none
+    double recall(int c) const {
+        size_t actual = counts[c][0] + counts[c][1];
+        return actual == 0 ? NAN : (double)counts[c][c] / actual;
+    }
+
+    // share of the rows predicted as c that are of class c; nan if there are none
+    double precision(int c) const {
+        size_t predicted = counts[0][c] + counts[1][c];
+        return predicted == 0 ? NAN : (double)counts[c][c] / predicted;
+    }
+
+    // mean negative log-likelihood of the labels
+    double logLoss() const {
+        return total() == 0 ? NAN : logLossSum / total();
+    }
+};
+
+/* score n probabilities of class 1 against the labels (0 or 1, of any numeric type) in one pass
+ * a probability above threshold predicts 1; the work is split across threads for large inputs
+ */
+template <typename Label>
+BinaryMetrics evaluateMetrics(const double* probs, const Label* labels, size_t n, double threshold = 0.5,
+    int threads = 1) {
+    size_t blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    std::vector<BinaryMetrics> partial(blocks);
+    forEachBlock(blocks, threads, [&](size_t b) {
+        size_t end = std::min(n, (b + 1) * REDUCTION_BLOCK);
+        for (size_t i = b * REDUCTION_BLOCK; i < end; i++) {
+            partial[b].add(probs[i], (double)labels[i], threshold);
+        }
+    });
+
+    BinaryMetrics result;
+    for (const BinaryMetrics& p : partial) {
+        result.merge(p);
+    }
+    return result;
+}
+
+// one threshold of the ROC and precision/recall curves; rows with a probability >= threshold predict 1
+struct CurvePoint {
+    double threshold;
+    double falsePositiveRate;
+    double truePositiveRate;
+    // nan at a threshold that predicts no 1s
+    double precision;
+};
+
+struct RocCurve {
+    // from the highest threshold down; the first point is (0, 0) and the last (1, 1)
+    std::vector<CurvePoint> points;
+    double auc = NAN;
+    double averagePrecision = NAN;
+};
+
+/* build the curves from groups of rows in decreasing order of probability
+ * group g holds positives[g] rows of class 1 and negatives[g] of class 0 at threshold thresholds[g]
+ */
+inline RocCurve curveFromGroups(const std::vector<double>& thresholds, const std::vector<size_t>& positives,
+    const std::vector<size_t>& negatives) {
+    size_t totalPositives = 0;
+    size_t totalNegatives = 0;
+    for (size_t g = 0; g < thresholds.size(); g++) {
+        totalPositives += positives[g];
+        totalNegatives += negatives[g];
+    }
+
+    RocCurve curve;
+    curve.points.reserve(thresholds.size() + 1);
+    curve.points.push_back({ INFINITY, 0, 0, NAN });
+    if (totalPositives == 0 || totalNegatives == 0) {
+        return curve;
+    }
+
+    size_t tp = 0;
+    size_t fp = 0;
+    double area = 0;
+    double precisionArea = 0;
+    for (size_t g = 0; g < thresholds.size(); g++) {
+        if (positives[g] == 0 && negatives[g] == 0) {
+            continue;
+        }
+        tp += positives[g];
+        fp += negatives[g];
+        const CurvePoint& last = curve.points.back();
+        CurvePoint point = { thresholds[g], (double)fp / totalNegatives, (double)tp / totalPositives, (double)tp / (tp + fp) };
+        area += (point.falsePositiveRate - last.falsePositiveRate) * (point.truePositiveRate + last.truePositiveRate) / 2;
+        precisionArea += (point.truePositiveRate - last.truePositiveRate) * point.precision;
+        curve.points.push_back(point);
+    }
+    curve.auc = area;
+    curve.averagePrecision = precisionArea;
+    return curve;
+}
+
+/* the exact ROC and precision/recall curves of n probabilities of class 1 against the labels
+ * (0 or 1, of any numeric type), with one point per distinct probability; sorts a copy of the pairs once
+ */
+template <typename Label>
+RocCurve rocCurve(const double* probs, const Label* labels, size_t n) {
+    struct Scored {
+        double p;
+        bool positive;
+    };
+    std::vector<Scored> rows(n);
+    for (size_t i = 0; i < n; i++) {
+        rows[i] = { probs[i], labels[i] == 1 };
+    }
+    std::sort(rows.begin(), rows.end(), [](const Scored& a, const Scored& b) { return a.p > b.p; });
+
+    std::vector<double> thresholds;
+    std::vector<size_t> positives;
+    std::vector<size_t> negatives;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || rows[i].p != rows[i - 1].p) {
+            thresholds.push_back(rows[i].p);
+            positives.push_back(0);
+            negatives.push_back(0);
+        }
+        (rows[i].positive ? positives : negatives).back()++;
+    }
+    return curveFromGroups(thresholds, positives, negatives);
+}
+
+// counts of positives and negatives in equal-width probability bins, for streaming evaluation
+class ScoreHistogram {
+public:
+    explicit ScoreHistogram(size_t bins = SCORE_HISTOGRAM_BINS)
+        : positives(std::max(bins, (size_t)1)), negatives(std::max(bins, (size_t)1)) {}
+
+    size_t bins() const { return positives.size(); }
+
+    // add one row: p = predicted probability of class 1, label = 0 or 1
+    void add(double p, double label) {
+        size_t bin = std::min((size_t)(std::min(std::max(p, 0.0), 1.0) * bins()), bins() - 1);
+        (label == 1 ? positives : negatives)[bin]++;
+    }
+
+    // add n rows
+    void add(const double* probs, const double* labels, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            add(probs[i], labels[i]);
+        }
+    }
+
+    // add the counts of a histogram with the same number of bins
+    void merge(const ScoreHistogram& other) {
+        for (size_t b = 0; b < bins(); b++) {
+            positives[b] += other.positives[b];
+            negatives[b] += other.negatives[b];
+        }
+    }
+
+    // the curves with one point per non-empty bin, at the bin's lower edge
+    RocCurve curve() const {
+        std::vector<double> thresholds(bins());
+        std::vector<size_t> pos(positives.rbegin(), positives.rend());
+        std::vector<size_t> neg(negatives.rbegin(), negatives.rend());
+        for (size_t b = 0; b < bins(); b++) {
+            thresholds[b] = (double)(bins() - 1 - b) / bins();
+        }
+        return curveFromGroups(thresholds, pos, neg);
+    }
+
+private:
+    std::vector<size_t> positives;
+    std::vector<size_t> negatives;
+};
+
+/* the histogram of n probabilities of class 1 against the labels (0 or 1) in one pass,
+ * with every thread filling its own histogram of a contiguous range of the rows
+ */
+inline ScoreHistogram collectHistogram(const double* probs, const double* labels, size_t n,
+    size_t bins = SCORE_HISTOGRAM_BINS, int threads = 1) {
+    size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / (MIN_BLOCKS_PER_THREAD * REDUCTION_BLOCK)));
+    std::vector<ScoreHistogram> partial(workers, ScoreHistogram(bins));
+    ThreadPool pool((int)workers);
+    pool.run(workers, [&](size_t t) {
+        size_t begin = n * t / workers;
+        partial[t].add(probs + begin, labels + begin, n * (t + 1) / workers - begin);
+    });
+
+    for (size_t t = 1; t < workers; t++) {
+        partial[0].merge(partial[t]);
+    }
+    return partial[0];
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*
+Module Name : Model File
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Save a trained model (logistic regression weights, naive Bayes probabilities or counts) to a compact
+binary file and load it back without parsing, so a model can be scored by other processes
+
+Module Design Description
+A model file starts with a fixed header (magic, format version, byte-order mark, model kind,
+number of arrays, file size), followed by one entry per array (name, shape, and where its
+values start). The values of every array are doubles stored row by row, each array starting
+on a 64-byte boundary, so a reader can memory-map the file and use the arrays in place.
+ModelWriter collects the arrays and writes the file under a temporary name before renaming
+it, the same way the column cache is written. ModelFile maps a file, checks the header and
+that every array lies inside the file, and looks arrays up by name and shape.
+*/
+
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include "MappedFile.h"
+
+const char MODEL_MAGIC[8] = { 'M', 'L', 'M', 'O', 'D', 'E', 'L', '\0' };
+const uint32_t MODEL_VERSION = 1;
+// written as a number so a model saved on a machine with the other byte order is rejected
+const uint32_t MODEL_BYTE_ORDER = 0x01020304;
+const size_t MODEL_ALIGNMENT = 64;
+
+// what kind of model a file holds
+enum ModelKind : uint32_t {
+    MODEL_LOGISTIC = 1,
+    MODEL_NAIVE_BAYES = 2,
+    // the counts a naive Bayes model is trained from, which can be merged with others
+    MODEL_NAIVE_BAYES_STATS = 3
+};
+
+struct ModelHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t kind;
+    uint32_t numArrays;
+    uint64_t fileSize;
+};
+
+struct ModelArray {
+    char name[32];
+    uint64_t rows;
+    uint64_t cols;
+    // byte offset of the first value from the start of the file
+    uint64_t offset;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(ModelHeader) == 32, "model header layout changed");
+static_assert(sizeof(ModelArray) == 64, "model array layout changed");
+
+inline size_t alignModel(size_t n) {
+    return (n + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+}
+
+class ModelWriter {
+public:
+    explicit ModelWriter(ModelKind kind) : kind(kind) {}
+
+    // add a rows x cols array (row by row); names longer than 31 characters are cut
+    void add(const std::string& name, size_t rows, size_t cols, const double* values) {
+        ModelArray entry;
+        memset(&entry, 0, sizeof(entry));
+        strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+        entry.rows = rows;
+        entry.cols = cols;
+        entries.push_back(entry);
+        arrays.emplace_back(values, values + rows * cols);
+    }
+
+    // add a table stored as a vector of rows, which must all have the same length
+    void add(const std::string& name, const std::vector<std::vector<double>>& table) {
+        std::vector<double> flat;
+        for (const std::vector<double>& row : table) {
+            flat.insert(flat.end(), row.begin(), row.end());
+        }
+        add(name, table.size(), table.empty() ? 0 : table[0].size(), flat.data());
+    }
+
+    // write the file; it is written under a temporary name and renamed so a reader never sees half a model
+    bool write(const std::string& path, std::string& error) {
+        size_t offset = alignModel(sizeof(ModelHeader) + entries.size() * sizeof(ModelArray));
+        for (ModelArray& entry : entries) {
+            entry.offset = offset;
+            offset = alignModel(offset + entry.rows * entry.cols * sizeof(double));
+        }
+
+        ModelHeader header = {};
+        memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+        header.version = MODEL_VERSION;
+        header.byteOrder = MODEL_BYTE_ORDER;
+        header.kind = kind;
+        header.numArrays = (uint32_t)entries.size();
+        header.fileSize = offset;
+
+        std::string tempPath = path + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            error = "Could not create " + tempPath;
+            return false;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)entries.data(), entries.size() * sizeof(ModelArray));
+
+        const char padding[MODEL_ALIGNMENT] = {};
+        for (size_t a = 0; a < entries.size(); a++) {
+            size_t position = (size_t)out.tellp();
+            out.write(padding, entries[a].offset - position);
+            out.write((const char*)arrays[a].data(), arrays[a].size() * sizeof(double));
+        }
+        out.write(padding, offset - (size_t)out.tellp());
+        out.close();
+        if (!out) {
+            error = "Could not write " + tempPath;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            error = "Could not rename " + tempPath + " to " + path;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    ModelKind kind;
+    std::vector<ModelArray> entries;
+    std::vector<std::vector<double>> arrays;
+};
+
+// a memory-mapped model file; the arrays point straight into the mapping
+class ModelFile {
+public:
+    // map the model at path; returns false with error set if it is missing or not a valid model file
+    bool open(const std::string& path, std::string& error) {
+        if (!file.open(path)) {
+            error = "Could not open " + path;
+            return false;
+        }
+        if (file.size() < sizeof(ModelHeader)) {
+            error = path + " is not a model file";
+            return false;
+        }
+        header = (const ModelHeader*)file.data();
+        if (memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0) {
+            error = path + " is not a model file";
+            return false;
+        }
+        if (header->version != MODEL_VERSION || header->byteOrder != MODEL_BYTE_ORDER) {
+            error = path + " was saved with another format version or byte order";
+            return false;
+        }
+
+        // make sure every array lies inside the file before handing out pointers to it
+        if (header->fileSize != file.size() || sizeof(ModelHeader) + header->numArrays * sizeof(ModelArray) > file.size()) {
+            error = path + " is truncated";
+            return false;
+        }
+        entries = (const ModelArray*)(file.data() + sizeof(ModelHeader));
+        for (uint32_t a = 0; a < header->numArrays; a++) {
+            if (entries[a].offset % MODEL_ALIGNMENT != 0 ||
+                entries[a].offset + entries[a].rows * entries[a].cols * sizeof(double) > file.size()) {
+                error = path + " is truncated";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ModelKind kind() const { return (ModelKind)header->kind; }
+
+    /* the values of the array called name, or nullptr if there is none
+     * rows and cols receive its shape
+     */
+    const double* find(const std::string& name, size_t& rows, size_t& cols) const {
+        for (uint32_t a = 0; a < header->numArrays; a++) {
+            if (strncmp(entries[a].name, name.c_str(), sizeof(entries[a].name)) == 0) {
+                rows = entries[a].rows;
+                cols = entries[a].cols;
+                return (const double*)(file.data() + entries[a].offset);
+            }
+        }
+        return nullptr;
+    }
+
+    // the array called name if it has exactly this shape, otherwise nullptr
+    const double* find(const std::string& name, size_t rows, size_t cols, std::string& error) const {
+        size_t r;
+        size_t c;
+        const double* values = find(name, r, c);
+        if (values == nullptr || r != rows || c != cols) {
+            error = "The model has no " + std::to_string(rows) + " x " + std::to_string(cols) + " array " + name;
+            return nullptr;
+        }
+        return values;
+    }
+
+private:
+    MappedFile file;
+    const ModelHeader* header = nullptr;
+    const ModelArray* entries = nullptr;
+};
+
+#endif
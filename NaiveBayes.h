@@ -0,0 +1,786 @@
+/*
+Module Name : Naive Bayes
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Collect everything a naive Bayes model is trained from (how many rows each class has, how
+often every value of every categorical feature occurs in each class, and the mean and variance
+of every numeric feature in each class) in a single scan over the rows
+
+Module Design Description
+Classes and categorical values are small non-negative integer codes (survived 0/1, pclass
+1..3, a dictionary code); the tables grow to the largest code seen, so a feature can have any
+number of levels and there can be any number of classes. NaiveBayesCounts holds the class
+counts, one contingency table per categorical feature (counts[class][value]) and one
+RunningStats per numeric feature and class. countNaiveBayes reads every column once: first
+the labels are turned into class codes, then every feature column is counted against them. A
+column can be of any type (ColumnRef, see TypedColumns.h) and is read as an array of that type,
+so a uint8 column costs an eighth of the bandwidth of a double one. It can also count only the
+rows in a list of row numbers (a shuffled split or a fold of a TableView), reading them in
+place. Like groupBy, it splits the rows into one contiguous range per thread,
+fills a separate set of tables for each range, and merges them in range order at the end, so
+the threads never share a counter.
+NaiveBayesModel is what prediction needs and nothing else. fit turns the counts into flat
+arrays of log-probabilities: the log prior of every class, and for every categorical feature
+one table with the log-likelihoods of all classes for a value next to each other (so one row
+value means one contiguous read), plus the mean and the precomputed constants
+-log(sqrt(2 pi var)) and 1 / (2 var) of every Gaussian feature and class, so scoring never
+touches the training data and never calls sqrt or divides.
+predictBatch works on blocks of NAIVE_BAYES_BLOCK rows and keeps the block's log scores class
+by class (one array of rows per class), so every step runs down a contiguous array of rows:
+the values of a categorical feature are turned into table offsets once, every class's
+log-likelihoods are gathered from the flat table at those offsets, and a numeric feature is
+copied out of the rows once and then scored against every class. The posteriors come from
+log-sum-exp: the largest score of a row is subtracted before taking exponentials, so they sum
+to 1 without underflowing however many features there are. The exponentials use fastExp from
+SigmoidKernels.h (relative error below 1e-14). With AVX2 every step handles 4 rows per
+instruction (the lookups with gather instructions); otherwise the same arithmetic runs one row
+at a time, so the results do not depend on the CPU. Large batches are split into one range of
+rows per thread. A row with a categorical value the model has no level for gets nan
+posteriors.
+The counts are sufficient statistics: two sets of counts built from different rows merge into
+exactly the counts of all the rows (the Gaussian means and squared deviations are combined
+with the parallel form of Welford's update). So a model keeps its counts, partialFit counts a
+new batch of rows and merges it in, and merge combines the models of shards trained by
+separate processes; both rebuild the log-probability arrays from the merged counts, which is
+cheap next to reading the rows. saveNaiveBayesCounts writes the counts to a model file (kind
+MODEL_NAIVE_BAYES_STATS, see ModelFile.h) so shards can be trained on other machines or on
+other nights and merged later; loadNaiveBayesCounts reads them back.
+*/
+
+#ifndef NAIVE_BAYES_H
+#define NAIVE_BAYES_H
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
+#include "StreamingStats.h"
+#include "SigmoidKernels.h"
+#include "Reduction.h"
+#include "ModelFile.h"
+#include "TypedColumns.h"
+
+// smallest number of rows worth giving their own thread
+const size_t MIN_NAIVE_BAYES_ROWS = 1 << 16;
+// codes of classes and categorical values must be below this
+const size_t MAX_CATEGORY_CODE = 1 << 20;
+const double TWO_PI = 6.283185307179586476925;
+// rows scored together by predictBatch
+const size_t NAIVE_BAYES_BLOCK = 256;
+
+// the code of a class or categorical value; false if v is not a whole number in [0, MAX_CATEGORY_CODE)
+inline bool categoryCode(double v, size_t& code) {
+    if (!(v >= 0 && v < MAX_CATEGORY_CODE)) {
+        return false;
+    }
+    // truncating and comparing is cheaper than std::floor, which is a library call on plain x86-64
+    code = (size_t)v;
+    return (double)code == v;
+}
+
+inline bool categoryCode(float v, size_t& code) {
+    return categoryCode((double)v, code);
+}
+
+// an integer column only needs its range checked
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type categoryCode(T v, size_t& code) {
+    code = (size_t)v;
+    return v >= 0 && code < MAX_CATEGORY_CODE;
+}
+
+struct NaiveBayesCounts {
+    // rows of every class
+    std::vector<size_t> classCounts;
+    // valueCounts[f][c][v] = rows of class c whose categorical feature f has value v
+    std::vector<std::vector<std::vector<size_t>>> valueCounts;
+    // numericStats[g][c] = stats of numeric feature g over the rows of class c
+    std::vector<std::vector<RunningStats>> numericStats;
+
+    NaiveBayesCounts(size_t categorical = 0, size_t numeric = 0) : valueCounts(categorical), numericStats(numeric) {}
+
+    size_t classes() const { return classCounts.size(); }
+
+    size_t rows() const {
+        size_t total = 0;
+        for (size_t count : classCounts) {
+            total += count;
+        }
+        return total;
+    }
+
+    // number of levels of categorical feature f (one more than its largest value)
+    size_t levels(size_t f) const {
+        size_t most = 0;
+        for (const std::vector<size_t>& counts : valueCounts[f]) {
+            most = std::max(most, counts.size());
+        }
+        return most;
+    }
+
+    // rows of class c whose categorical feature f has value v
+    size_t count(size_t f, size_t c, size_t v) const {
+        const std::vector<size_t>& counts = valueCounts[f][c];
+        return v < counts.size() ? counts[v] : 0;
+    }
+
+    // make room for class c
+    void addClass(size_t c) {
+        if (c < classes()) {
+            return;
+        }
+        classCounts.resize(c + 1, 0);
+        for (std::vector<std::vector<size_t>>& table : valueCounts) {
+            table.resize(c + 1);
+        }
+        for (std::vector<RunningStats>& stats : numericStats) {
+            stats.resize(c + 1);
+        }
+    }
+
+    // count value v of categorical feature f in class c (which must have been added)
+    void addValue(size_t f, size_t c, size_t v) {
+        std::vector<size_t>& counts = valueCounts[f][c];
+        if (v >= counts.size()) {
+            counts.resize(v + 1, 0);
+        }
+        counts[v]++;
+    }
+
+    // true if other was counted from the same number of categorical and numeric features
+    bool sameFeatures(const NaiveBayesCounts& other) const {
+        return valueCounts.size() == other.valueCounts.size() && numericStats.size() == other.numericStats.size();
+    }
+
+    // add the counts of tables built from other rows with the same features
+    void merge(const NaiveBayesCounts& other) {
+        if (other.classes() > 0) {
+            addClass(other.classes() - 1);
+        }
+        for (size_t c = 0; c < other.classes(); c++) {
+            classCounts[c] += other.classCounts[c];
+            for (size_t f = 0; f < valueCounts.size(); f++) {
+                const std::vector<size_t>& counts = other.valueCounts[f][c];
+                std::vector<size_t>& mine = valueCounts[f][c];
+                if (counts.size() > mine.size()) {
+                    mine.resize(counts.size(), 0);
+                }
+                for (size_t v = 0; v < counts.size(); v++) {
+                    mine[v] += counts[v];
+                }
+            }
+            for (size_t g = 0; g < numericStats.size(); g++) {
+                numericStats[g][c].merge(other.numericStats[g][c]);
+            }
+        }
+    }
+};
+
+/* count the classes in labels, the values of every categorical column per class, and the stats
+ * of every numeric column per class, in one pass over the columns with the rows split across threads
+ * only the rows index[0..n) of the columns are counted, or the first n rows if index is null
+ * the columns can be of any type; labels and categorical values must be codes (see categoryCode)
+ * returns false with error set if a label or categorical value is not a code
+ */
+inline bool countNaiveBayes(const std::vector<ColumnRef>& categorical, const std::vector<ColumnRef>& numeric,
+    ColumnRef labels, const size_t* index, size_t n, NaiveBayesCounts& counts, std::string& error, int threads = 1) {
+    size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / MIN_NAIVE_BAYES_ROWS));
+
+    std::vector<NaiveBayesCounts> partial(workers, NaiveBayesCounts(categorical.size(), numeric.size()));
+    // first row of each range that is not a code, or n if there is none
+    std::vector<size_t> badRow(workers, n);
+    std::vector<std::thread> pool;
+
+    for (size_t w = 0; w < workers; w++) {
+        auto work = [&, w]() {
+            NaiveBayesCounts& table = partial[w];
+            size_t begin = n * w / workers;
+            // rows from the first one that is not a code on are skipped, since the counts are dropped then
+            size_t end = n * (w + 1) / workers;
+            std::vector<uint32_t> classes(end - begin);
+            labels.visit([&](const auto* values) {
+                for (size_t r = begin; r < end; r++) {
+                    size_t c;
+                    if (!categoryCode(values[index != nullptr ? index[r] : r], c)) {
+                        end = r;
+                        break;
+                    }
+                    table.addClass(c);
+                    table.classCounts[c]++;
+                    classes[r - begin] = (uint32_t)c;
+                }
+            });
+            for (size_t f = 0; f < categorical.size(); f++) {
+                categorical[f].visit([&](const auto* values) {
+                    for (size_t r = begin; r < end; r++) {
+                        size_t v;
+                        if (!categoryCode(values[index != nullptr ? index[r] : r], v)) {
+                            end = r;
+                            break;
+                        }
+                        table.addValue(f, classes[r - begin], v);
+                    }
+                });
+            }
+            for (size_t g = 0; g < numeric.size(); g++) {
+                numeric[g].visit([&](const auto* values) {
+                    for (size_t r = begin; r < end; r++) {
+                        table.numericStats[g][classes[r - begin]].add((double)values[index != nullptr ? index[r] : r]);
+                    }
+                });
+            }
+            if (end < n * (w + 1) / workers) {
+                badRow[w] = end;
+            }
+        };
+        if (workers == 1) {
+            work();
+        }
+        else {
+            pool.emplace_back(work);
+        }
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    for (size_t w = 0; w < workers; w++) {
+        if (badRow[w] < n) {
+            size_t row = index != nullptr ? index[badRow[w]] : badRow[w];
+            error = "Row " + std::to_string(row + 1) + " has a class or category that is not a whole number from 0 to "
+                + std::to_string(MAX_CATEGORY_CODE - 1);
+            return false;
+        }
+    }
+
+    // merge the ranges in order so the stats do not depend on which thread finished first
+    counts = partial[0];
+    for (size_t w = 1; w < workers; w++) {
+        counts.merge(partial[w]);
+    }
+    return true;
+}
+
+// count every row of the columns, which must have the same length (see above)
+inline bool countNaiveBayes(const std::vector<ColumnRef>& categorical, const std::vector<ColumnRef>& numeric,
+    ColumnRef labels, NaiveBayesCounts& counts, std::string& error, int threads = 1) {
+    return countNaiveBayes(categorical, numeric, labels, nullptr, labels.size, counts, error, threads);
+}
+
+#if defined(REDUCTION_DISPATCH)
+/* index[r] = offset + v * classes for the value v = values[r * stride] of the first n rows
+ * (n a multiple of 4); a value that is not a code below levels gives offset and sets unknown[r]
+ */
+__attribute__((target("avx2")))
+inline void tableIndexAvx2(const double* values, size_t stride, size_t n, size_t levels, size_t offset, size_t classes,
+    int64_t* index, char* unknown) {
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const __m256d limit = _mm256_set1_pd((double)levels);
+    // 64-bit offsets: classes and levels can each be up to MAX_CATEGORY_CODE, so a table can be
+    // larger than a 32-bit index reaches
+    const __m256i base = _mm256_set1_epi64x((int64_t)offset);
+    const __m256i width = _mm256_set1_epi64x((int64_t)classes);
+    const __m128i step = _mm_set1_epi32((int32_t)(4 * stride));
+    __m128i at = _mm_setr_epi32(0, (int32_t)stride, (int32_t)(2 * stride), (int32_t)(3 * stride));
+    for (size_t r = 0; r < n; r += 4, at = _mm_add_epi32(at, step)) {
+        __m256d v = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values, at, all, 8);
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(v, _mm256_setzero_pd(), _CMP_GE_OQ), _mm256_cmp_pd(v, limit, _CMP_LT_OQ));
+        // a bad value reads level 0
+        v = _mm256_and_pd(v, ok);
+        __m128i code = _mm256_cvttpd_epi32(v);
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(_mm256_cvtepi32_pd(code), v, _CMP_EQ_OQ));
+        code = _mm_and_si128(code, _mm256_cvtpd_epi32(_mm256_and_pd(ok, _mm256_set1_pd(-1))));
+        // codes and classes are below 2^20, so the 32 x 32 -> 64-bit product is exact
+        __m256i product = _mm256_mul_epu32(_mm256_cvtepi32_epi64(code), width);
+        _mm256_storeu_si256((__m256i*)(index + r), _mm256_add_epi64(base, product));
+        int good = _mm256_movemask_pd(ok);
+        for (int i = 0; i < 4; i++) {
+            unknown[r + i] |= !((good >> i) & 1);
+        }
+    }
+}
+
+// column[r] = values[r * stride] for the first n rows (n a multiple of 4)
+__attribute__((target("avx2")))
+inline void gatherColumnAvx2(const double* values, size_t stride, size_t n, double* column) {
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const __m128i step = _mm_set1_epi32((int32_t)(4 * stride));
+    __m128i at = _mm_setr_epi32(0, (int32_t)stride, (int32_t)(2 * stride), (int32_t)(3 * stride));
+    for (size_t r = 0; r < n; r += 4, at = _mm_add_epi32(at, step)) {
+        _mm256_storeu_pd(column + r, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values, at, all, 8));
+    }
+}
+
+// score[r] += table[index[r]] for the first n rows (n a multiple of 4)
+__attribute__((target("avx2")))
+inline void addGatheredAvx2(double* score, const double* table, const int64_t* index, size_t n) {
+    // the masked form with every lane on, so no lane starts out undefined
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (size_t r = 0; r < n; r += 4) {
+        __m256i at = _mm256_loadu_si256((const __m256i*)(index + r));
+        __m256d value = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), table, at, all, 8);
+        _mm256_storeu_pd(score + r, _mm256_add_pd(_mm256_loadu_pd(score + r), value));
+    }
+}
+
+// score[r] += logScale - (x[r] - mean)^2 * halfPrecision for the first n rows (n a multiple of 4)
+__attribute__((target("avx2")))
+inline void addGaussianAvx2(double* score, const double* x, size_t n, double mean, double logScale, double halfPrecision) {
+    __m256d m = _mm256_set1_pd(mean);
+    __m256d scale = _mm256_set1_pd(logScale);
+    __m256d h = _mm256_set1_pd(halfPrecision);
+    for (size_t r = 0; r < n; r += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + r), m);
+        __m256d product = _mm256_mul_pd(_mm256_mul_pd(d, d), h);
+        KEEP_UNFUSED(product);
+        __m256d term = _mm256_sub_pd(scale, product);
+        _mm256_storeu_pd(score + r, _mm256_add_pd(_mm256_loadu_pd(score + r), term));
+    }
+}
+
+// normalizeScores for the first n rows (n a multiple of 4)
+__attribute__((target("avx2")))
+inline void normalizeScoresAvx2(double* scores, size_t stride, size_t classes, size_t n, char* unknown) {
+    const __m256d none = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    for (size_t r = 0; r < n; r += 4) {
+        __m256d top = none;
+        for (size_t c = 0; c < classes; c++) {
+            top = _mm256_max_pd(top, _mm256_loadu_pd(scores + c * stride + r));
+        }
+        __m256d total = _mm256_setzero_pd();
+        for (size_t c = 0; c < classes; c++) {
+            __m256d s = _mm256_loadu_pd(scores + c * stride + r);
+            // an impossible class (log 0) gets exactly 0
+            __m256d e = _mm256_andnot_pd(_mm256_cmp_pd(s, none, _CMP_EQ_OQ), fastExpAvx2(_mm256_sub_pd(s, top)));
+            _mm256_storeu_pd(scores + c * stride + r, e);
+            total = _mm256_add_pd(total, e);
+        }
+        for (size_t c = 0; c < classes; c++) {
+            _mm256_storeu_pd(scores + c * stride + r, _mm256_div_pd(_mm256_loadu_pd(scores + c * stride + r), total));
+        }
+        int impossible = _mm256_movemask_pd(_mm256_cmp_pd(top, none, _CMP_EQ_OQ));
+        for (int i = 0; i < 4; i++) {
+            unknown[r + i] |= (impossible >> i) & 1;
+        }
+    }
+}
+#endif
+
+/* index[r] = offset + v * classes for the value v = values[r * stride] of n rows, the start of
+ * v's log-likelihoods in the table; a value that is not a code below levels gives offset and
+ * sets unknown[r]
+ */
+inline void tableIndex(const double* values, size_t stride, size_t n, size_t levels, size_t offset, size_t classes,
+    int64_t* index, char* unknown) {
+    size_t done = 0;
+#if defined(REDUCTION_DISPATCH)
+    if (reductionIsa() >= ISA_AVX2) {
+        done = n / 4 * 4;
+        tableIndexAvx2(values, stride, done, levels, offset, classes, index, unknown);
+    }
+#endif
+    for (size_t r = done; r < n; r++) {
+        size_t v;
+        if (!categoryCode(values[r * stride], v) || v >= levels) {
+            unknown[r] = 1;
+            v = 0;
+        }
+        index[r] = (int64_t)(offset + v * classes);
+    }
+}
+
+// column[r] = values[r * stride] for n rows
+inline void gatherColumn(const double* values, size_t stride, size_t n, double* column) {
+    size_t done = 0;
+#if defined(REDUCTION_DISPATCH)
+    if (reductionIsa() >= ISA_AVX2) {
+        done = n / 4 * 4;
+        gatherColumnAvx2(values, stride, done, column);
+    }
+#endif
+    for (size_t r = done; r < n; r++) {
+        column[r] = values[r * stride];
+    }
+}
+
+// score[r] += table[index[r]] for n rows
+inline void addGathered(double* score, const double* table, const int64_t* index, size_t n) {
+    size_t done = 0;
+#if defined(REDUCTION_DISPATCH)
+    if (reductionIsa() >= ISA_AVX2) {
+        done = n / 4 * 4;
+        addGatheredAvx2(score, table, index, done);
+    }
+#endif
+    for (size_t r = done; r < n; r++) {
+        score[r] += table[index[r]];
+    }
+}
+
+// score[r] += logScale - (x[r] - mean)^2 * halfPrecision for n rows
+inline void addGaussian(double* score, const double* x, size_t n, double mean, double logScale, double halfPrecision) {
+    size_t done = 0;
+#if defined(REDUCTION_DISPATCH)
+    if (reductionIsa() >= ISA_AVX2) {
+        done = n / 4 * 4;
+        addGaussianAvx2(score, x, done, mean, logScale, halfPrecision);
+    }
+#endif
+    for (size_t r = done; r < n; r++) {
+        double d = x[r] - mean;
+        // kept apart from the subtraction, so FMA contraction cannot make it differ from the AVX2 path
+        double product = d * d * halfPrecision;
+        KEEP_UNFUSED(product);
+        score[r] += logScale - product;
+    }
+}
+
+/* scores holds classes arrays of n log scores (array c starts at scores + c * stride); replace
+ * them with the posteriors e^score / sum of e^score of the row, computed as e^(score - largest)
+ * so they cannot underflow; sets unknown[r] for a row where every class is impossible (log 0)
+ */
+inline void normalizeScores(double* scores, size_t stride, size_t classes, size_t n, char* unknown) {
+    const double none = -std::numeric_limits<double>::infinity();
+    size_t done = 0;
+#if defined(REDUCTION_DISPATCH)
+    if (reductionIsa() >= ISA_AVX2) {
+        done = n / 4 * 4;
+        normalizeScoresAvx2(scores, stride, classes, done, unknown);
+    }
+#endif
+    for (size_t r = done; r < n; r++) {
+        double top = none;
+        for (size_t c = 0; c < classes; c++) {
+            top = std::max(top, scores[c * stride + r]);
+        }
+        double total = 0;
+        for (size_t c = 0; c < classes; c++) {
+            double s = scores[c * stride + r];
+            double e = s == none ? 0 : fastExp(s - top);
+            scores[c * stride + r] = e;
+            total += e;
+        }
+        for (size_t c = 0; c < classes; c++) {
+            scores[c * stride + r] /= total;
+        }
+        unknown[r] |= top == none;
+    }
+}
+
+class NaiveBayesModel {
+public:
+    NaiveBayesModel() {}
+
+    // an empty model (all probabilities 0) with levels[f] values for every categorical feature
+    NaiveBayesModel(size_t classes, const std::vector<size_t>& levels, size_t numeric) {
+        shape(classes, levels, numeric);
+    }
+
+    // train on the counts of countNaiveBayes (or merged shard counts)
+    void fit(const NaiveBayesCounts& counts) {
+        stats = counts;
+        build();
+    }
+
+    /* train on the rows of the columns (see countNaiveBayes)
+     * returns false with error set if a label or categorical value is not a code
+     */
+    bool fit(const std::vector<ColumnRef>& categorical, const std::vector<ColumnRef>& numeric, ColumnRef labels,
+        std::string& error, int threads = 1) {
+        stats = NaiveBayesCounts(categorical.size(), numeric.size());
+        return partialFit(categorical, numeric, labels, error, threads);
+    }
+
+    /* add a new batch of rows to what the model was trained on, without the old rows
+     * the columns must be the same features the model was trained with
+     * returns false with error set (and leaves the model as it was) if they are not, or a label
+     * or categorical value is not a code
+     */
+    bool partialFit(const std::vector<ColumnRef>& categorical, const std::vector<ColumnRef>& numeric, ColumnRef labels,
+        std::string& error, int threads = 1) {
+        return partialFit(categorical, numeric, labels, nullptr, labels.size, error, threads);
+    }
+
+    // the same for only the rows index[0..n) of the columns, or their first n rows if index is null
+    bool partialFit(const std::vector<ColumnRef>& categorical, const std::vector<ColumnRef>& numeric, ColumnRef labels,
+        const size_t* index, size_t n, std::string& error, int threads = 1) {
+        NaiveBayesCounts batch(categorical.size(), numeric.size());
+        // a model that has never been trained takes the batch's features
+        if (stats.classes() == 0 && stats.valueCounts.empty() && stats.numericStats.empty()) {
+            stats = batch;
+        }
+        if (!batch.sameFeatures(stats)) {
+            error = "The batch has other features than the model";
+            return false;
+        }
+        if (!countNaiveBayes(categorical, numeric, labels, index, n, batch, error, threads)) {
+            return false;
+        }
+        stats.merge(batch);
+        build();
+        return true;
+    }
+
+    /* add the counts of a model trained on other rows (another shard) with the same features
+     * returns false with error set if the features differ
+     */
+    bool merge(const NaiveBayesModel& other, std::string& error) {
+        if (!stats.sameFeatures(other.stats)) {
+            error = "The models have different features";
+            return false;
+        }
+        stats.merge(other.stats);
+        build();
+        return true;
+    }
+
+    // the counts the model was built from (empty for a model built with the set functions)
+    const NaiveBayesCounts& statistics() const { return stats; }
+
+    size_t classes() const { return numClasses; }
+    size_t categoricalFeatures() const { return levelCounts.size(); }
+    size_t numericFeatures() const { return numNumeric; }
+    size_t levels(size_t f) const { return levelCounts[f]; }
+    // features per row of predictBatch: the categorical ones, then the numeric ones
+    size_t width() const { return levelCounts.size() + numNumeric; }
+
+    // the model's probabilities
+    double prior(size_t c) const { return std::exp(logPriors[c]); }
+    double likelihood(size_t f, size_t v, size_t c) const { return std::exp(logLikelihoods[offsets[f] + v * numClasses + c]); }
+    double mean(size_t g, size_t c) const { return means[g * numClasses + c]; }
+    double variance(size_t g, size_t c) const { return 1 / (2 * halfPrecisions[g * numClasses + c]); }
+
+    void setPrior(size_t c, double p) { logPriors[c] = std::log(p); }
+
+    // P(value v of categorical feature f | class c)
+    void setLikelihood(size_t f, size_t v, size_t c, double p) { logLikelihoods[offsets[f] + v * numClasses + c] = std::log(p); }
+
+    // the mean and variance of numeric feature g in class c
+    void setGaussian(size_t g, size_t c, double mean, double variance) {
+        size_t k = g * numClasses + c;
+        means[k] = mean;
+        logScales[k] = -0.5 * std::log(TWO_PI * variance);
+        halfPrecisions[k] = 1 / (2 * variance);
+    }
+
+    /* posterior probabilities of every class for n rows of width() features (row after row)
+     * posteriors receives n x classes() values, row after row; large batches are split across threads
+     */
+    void predictBatch(const double* rows, size_t n, double* posteriors, int threads = 1) const {
+        size_t workers = std::max((size_t)1, std::min((size_t)std::max(threads, 1), n / MIN_NAIVE_BAYES_ROWS));
+        if (workers == 1) {
+            scoreRows(rows, n, posteriors);
+            return;
+        }
+        std::vector<std::thread> pool;
+        for (size_t w = 0; w < workers; w++) {
+            size_t begin = n * w / workers;
+            size_t end = n * (w + 1) / workers;
+            pool.emplace_back([=]() { scoreRows(rows + begin * width(), end - begin, posteriors + begin * numClasses); });
+        }
+        for (std::thread& t : pool) {
+            t.join();
+        }
+    }
+
+private:
+    NaiveBayesCounts stats;
+    size_t numClasses = 0;
+    size_t numNumeric = 0;
+    std::vector<size_t> levelCounts;
+    // table of categorical feature f starts at offsets[f]; entry v * classes + c is log P(v | c)
+    std::vector<size_t> offsets;
+    std::vector<double> logLikelihoods;
+    std::vector<double> logPriors;
+    // entry g * classes + c: the mean, -log(sqrt(2 pi var)) and 1 / (2 var) of numeric feature g in class c
+    std::vector<double> means;
+    std::vector<double> logScales;
+    std::vector<double> halfPrecisions;
+
+    // predictBatch on the calling thread
+    void scoreRows(const double* rows, size_t n, double* posteriors) const {
+        size_t features = width();
+        size_t numCategorical = levelCounts.size();
+        // the block's scores, one array of rows per class
+        std::vector<double> scores(numClasses * NAIVE_BAYES_BLOCK);
+        std::vector<int64_t> index(NAIVE_BAYES_BLOCK);
+        std::vector<double> column(NAIVE_BAYES_BLOCK);
+        std::vector<char> unknown(NAIVE_BAYES_BLOCK);
+
+        for (size_t begin = 0; begin < n; begin += NAIVE_BAYES_BLOCK) {
+            size_t len = std::min(NAIVE_BAYES_BLOCK, n - begin);
+            const double* block = rows + begin * features;
+            for (size_t c = 0; c < numClasses; c++) {
+                std::fill(scores.begin() + c * NAIVE_BAYES_BLOCK, scores.begin() + c * NAIVE_BAYES_BLOCK + len, logPriors[c]);
+            }
+            std::fill(unknown.begin(), unknown.begin() + len, 0);
+
+            for (size_t f = 0; f < numCategorical; f++) {
+                tableIndex(block + f, features, len, levelCounts[f], offsets[f], numClasses, index.data(), unknown.data());
+                for (size_t c = 0; c < numClasses; c++) {
+                    addGathered(scores.data() + c * NAIVE_BAYES_BLOCK, logLikelihoods.data() + c, index.data(), len);
+                }
+            }
+
+            for (size_t g = 0; g < numNumeric; g++) {
+                gatherColumn(block + numCategorical + g, features, len, column.data());
+                for (size_t c = 0; c < numClasses; c++) {
+                    size_t k = g * numClasses + c;
+                    addGaussian(scores.data() + c * NAIVE_BAYES_BLOCK, column.data(), len, means[k], logScales[k], halfPrecisions[k]);
+                }
+            }
+
+            normalizeScores(scores.data(), NAIVE_BAYES_BLOCK, numClasses, len, unknown.data());
+            double* out = posteriors + begin * numClasses;
+            for (size_t r = 0; r < len; r++) {
+                for (size_t c = 0; c < numClasses; c++) {
+                    out[r * numClasses + c] = unknown[r] ? std::numeric_limits<double>::quiet_NaN() : scores[c * NAIVE_BAYES_BLOCK + r];
+                }
+            }
+        }
+    }
+
+    // the log-probability arrays of the counts in stats
+    void build() {
+        std::vector<size_t> levels(stats.valueCounts.size());
+        for (size_t f = 0; f < levels.size(); f++) {
+            levels[f] = stats.levels(f);
+        }
+        shape(stats.classes(), levels, stats.numericStats.size());
+
+        double rows = (double)stats.rows();
+        for (size_t c = 0; c < numClasses; c++) {
+            double classRows = (double)stats.classCounts[c];
+            setPrior(c, classRows / rows);
+            for (size_t f = 0; f < levels.size(); f++) {
+                for (size_t v = 0; v < levels[f]; v++) {
+                    setLikelihood(f, v, c, stats.count(f, c, v) / classRows);
+                }
+            }
+            for (size_t g = 0; g < numNumeric; g++) {
+                setGaussian(g, c, stats.numericStats[g][c].mean(), stats.numericStats[g][c].variance());
+            }
+        }
+    }
+
+    void shape(size_t classes, const std::vector<size_t>& levels, size_t numeric) {
+        numClasses = classes;
+        numNumeric = numeric;
+        levelCounts = levels;
+        offsets.assign(levels.size() + 1, 0);
+        for (size_t f = 0; f < levels.size(); f++) {
+            offsets[f + 1] = offsets[f] + levels[f] * classes;
+        }
+        double none = -std::numeric_limits<double>::infinity();
+        logLikelihoods.assign(offsets.back(), none);
+        logPriors.assign(classes, none);
+        means.assign(numeric * classes, 0);
+        logScales.assign(numeric * classes, 0);
+        halfPrecisions.assign(numeric * classes, 0);
+    }
+};
+
+// values stored for every class of a numeric feature: count, sum, mean, m2, min, max
+const size_t NUMERIC_STATS_WIDTH = 6;
+
+/* write the counts to a model file at path: arrays "classes" (1 x classes), "values<f>"
+ * (classes x levels) for every categorical feature and "numeric<g>" (classes x 6) for every
+ * numeric feature; returns false with error set if the file cannot be written
+ */
+inline bool saveNaiveBayesCounts(const NaiveBayesCounts& counts, const std::string& path, std::string& error) {
+    ModelWriter writer(MODEL_NAIVE_BAYES_STATS);
+    size_t classes = counts.classes();
+    std::vector<double> classCounts(counts.classCounts.begin(), counts.classCounts.end());
+    writer.add("classes", 1, classes, classCounts.data());
+
+    for (size_t f = 0; f < counts.valueCounts.size(); f++) {
+        size_t levels = counts.levels(f);
+        std::vector<double> table(classes * levels);
+        for (size_t c = 0; c < classes; c++) {
+            for (size_t v = 0; v < levels; v++) {
+                table[c * levels + v] = (double)counts.count(f, c, v);
+            }
+        }
+        writer.add("values" + std::to_string(f), classes, levels, table.data());
+    }
+
+    for (size_t g = 0; g < counts.numericStats.size(); g++) {
+        std::vector<double> table;
+        for (const RunningStats& stats : counts.numericStats[g]) {
+            table.insert(table.end(), { (double)stats.count, stats.total, stats.avg, stats.m2, stats.minVal, stats.maxVal });
+        }
+        writer.add("numeric" + std::to_string(g), classes, NUMERIC_STATS_WIDTH, table.data());
+    }
+    return writer.write(path, error);
+}
+
+/* read counts written by saveNaiveBayesCounts; the features are the values<f> and numeric<g>
+ * arrays found in the file. returns false with error set if it is not such a file
+ */
+inline bool loadNaiveBayesCounts(const std::string& path, NaiveBayesCounts& counts, std::string& error) {
+    ModelFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    size_t rows = 0;
+    size_t classes = 0;
+    const double* classCounts = file.find("classes", rows, classes);
+    if (file.kind() != MODEL_NAIVE_BAYES_STATS || classCounts == nullptr || rows != 1) {
+        error = path + " does not hold naive Bayes counts";
+        return false;
+    }
+
+    size_t categorical = 0;
+    size_t numeric = 0;
+    size_t levels = 0;
+    while (file.find("values" + std::to_string(categorical), rows, levels) != nullptr) {
+        categorical++;
+    }
+    while (file.find("numeric" + std::to_string(numeric), rows, levels) != nullptr) {
+        numeric++;
+    }
+
+    counts = NaiveBayesCounts(categorical, numeric);
+    if (classes == 0) {
+        return true;
+    }
+    counts.addClass(classes - 1);
+    for (size_t c = 0; c < classes; c++) {
+        counts.classCounts[c] = (size_t)classCounts[c];
+    }
+    for (size_t f = 0; f < categorical; f++) {
+        const double* table = file.find("values" + std::to_string(f), rows, levels);
+        if (rows != classes) {
+            error = path + " has a values" + std::to_string(f) + " array of the wrong shape";
+            return false;
+        }
+        for (size_t c = 0; c < classes; c++) {
+            counts.valueCounts[f][c].assign(table + c * levels, table + (c + 1) * levels);
+        }
+    }
+    for (size_t g = 0; g < numeric; g++) {
+        const double* table = file.find("numeric" + std::to_string(g), classes, NUMERIC_STATS_WIDTH, error);
+        if (table == nullptr) {
+            return false;
+        }
+        for (size_t c = 0; c < classes; c++) {
+            const double* values = table + c * NUMERIC_STATS_WIDTH;
+            RunningStats& stats = counts.numericStats[g][c];
+            stats.count = (long long)values[0];
+            stats.total = values[1];
+            stats.avg = values[2];
+            stats.m2 = values[3];
+            stats.minVal = values[4];
+            stats.maxVal = values[5];
+        }
+    }
+    return true;
+}
+
+#endif
@@ -18,384 +18,516 @@ Display the probabilties, test metrics, and run time of the naive Bayes model
 
 #define _USE_MATH_DEFINES
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <thread>
+#include "CsvReader.h"
+#include "ColumnCache.h"
+#include "TypedColumns.h"
+#include "NaiveBayes.h"
+#include "HashedNaiveBayes.h"
+#include "ModelFile.h"
+#include "ScoringServer.h"
+#include "CrossValidation.h"
+#include "Metrics.h"
 
 using namespace std;
 using namespace std::chrono;
 
-/* find the accuracy of the model using the formula accuracy = correct/total
- * predicted = vector of probabilities 1 or 0
- * lbls = survived vector
+// the columns of titanic_project.csv after the row id
+const int PCLASS_COLUMN = 0;
+const int SURVIVED_COLUMN = 1;
+const int SEX_COLUMN = 2;
+const int AGE_COLUMN = 3;
+
+// the categorical columns (pclass, sex) and numeric columns (age) of the data, in the
+// order the model's tables are numbered
+const int PCLASS_FEATURE = 0;
+const int SEX_FEATURE = 1;
+const int AGE_FEATURE = 0;
+
+/* train the model in one pass over the rows, on top of the counts in start (counts of earlier
+ * rows or other shards, empty by default)
+ * data = rows of the columns of titanic_project.csv, each in its own type, read in place;
+ * threads = number of threads to split the rows across
+ * returns false with error set if a survived, pclass or sex value is not a whole number
  */
-double accuracy(vector<double> predicted, vector<double> lbls) {
-    double correct = 0;
-
-    // find the amount of correct predictions
-    for (int i = 0; i < predicted.size(); i++) {
-        if (predicted[i] == lbls[i]) {
-            correct++;
-        }
+bool trainModel(const TableView& data, NaiveBayesModel& model, string& error, int threads = 1,
+    const NaiveBayesCounts& start = NaiveBayesCounts(2, 1)) {
+    // the model always has both classes (perished and survived), even if the rows only have one
+    NaiveBayesCounts counts = start;
+    counts.addClass(1);
+    model.fit(counts);
+    if (!model.partialFit({ data.column(PCLASS_COLUMN), data.column(SEX_COLUMN) }, { data.column(AGE_COLUMN) },
+        data.column(SURVIVED_COLUMN), data.index(), data.rows(), error, threads)) {
+        return false;
     }
-
-    // calculate accuracy
-    double acc = correct / predicted.size();
-
-    return acc;
+    const NaiveBayesCounts& stats = model.statistics();
+    if (stats.classes() != 2 || stats.levels(PCLASS_FEATURE) > 4 || stats.levels(SEX_FEATURE) > 2) {
+        error = "Expected survived and sex to be 0 or 1 and pclass to be 1, 2 or 3";
+        return false;
+    }
+    return true;
 }
 
-/* find the sensitivity of the model using the formula sensitivity = tp/(tp+fn)
- * predicted = vector of probabilities 1 or 0
- * lbls = survived vector
+/* load the counts saved by --stats-out from every file in paths and merge them into counts
+ * returns false with error set if a file cannot be read or was not counted from pclass, sex and age
  */
-double sensitivity(vector<double> predicted, vector<double> lbls) {
-    vector<double> predictions = predicted;
-    // tp = true positive; fn = false negative
-    double tp = 0;
-    double fn = 0;
-
-    // find tp and fn
-    for (int i = 0; i < predictions.size(); i++) {
-        if (predictions[i] == 0 && lbls[i] == 0) {
-            tp++;
+bool loadShards(const vector<string>& paths, NaiveBayesCounts& counts, string& error) {
+    for (const string& path : paths) {
+        NaiveBayesCounts shard;
+        if (!loadNaiveBayesCounts(path, shard, error)) {
+            return false;
         }
-        else if (predictions[i] == 1 && lbls[i] == 0) {
-            fn++;
+        if (!shard.sameFeatures(counts) || shard.classes() > 2) {
+            error = path + " was not counted from the pclass, sex and age columns";
+            return false;
         }
+        counts.merge(shard);
     }
+    return true;
+}
 
-    // check that the denominator isn't zero because then sensitivity is undefined
-    if ((tp + fn) == 0) {
-        return -1;
+// the a-priori of every class
+vector<double> getApriori(const NaiveBayesModel& model) {
+    vector<double> apriori(model.classes());
+    for (size_t c = 0; c < apriori.size(); c++) {
+        apriori[c] = model.prior(c);
     }
-
-    // calculate and return sensitivity
-    return tp / (tp + fn);
+    return apriori;
 }
 
-/* find the specificity of the model using the formula specificity = tn/(tn+fp)
- * predicted = vector of probabilities 1 or 0
- * lbls = survived vector
+/* the likelihood values of a categorical feature; P(value|class)
+ * one row per value from first_level to levels - 1 (pclass is 1..3), one column per class
  */
-double specificity(vector<double> predicted, vector<double> lbls) {
-    vector<double> predictions = predicted;
-    // tn = true negative; fp = false positive
-    double tn = 0;
-    double fp = 0;
-
-    // find tn and fp
-    for (int i = 0; i < predictions.size(); i++) {
-        if (predictions[i] == 1 && lbls[i] == 1) {
-            tn++;
-        }
-        else if (predictions[i] == 0 && lbls[i] == 1) {
-            fp++;
+vector<vector<double>> categoryLikelihood(const NaiveBayesModel& model, int feature, int first_level, int levels) {
+    vector<vector<double>> likelihood(levels - first_level, vector<double>(model.classes()));
+    for (size_t v = first_level; v < (size_t)levels && v < model.levels(feature); v++) {
+        for (size_t c = 0; c < model.classes(); c++) {
+            likelihood[v - first_level][c] = model.likelihood(feature, v, c);
         }
     }
+    return likelihood;
+}
 
-    // check that the denominator isn't zero because then specificity is undefined
-    if ((tn + fp) == 0) {
-        return -1;
+// the mean and variance of a quantitative feature for every class, which are needed to calculate its likelihood
+// returns {means, variances}
+vector<vector<double>> likelihoodQuan(const NaiveBayesModel& model, int feature) {
+    vector<double> means(model.classes());
+    vector<double> variances(model.classes());
+    for (size_t c = 0; c < model.classes(); c++) {
+        means[c] = model.mean(feature, c);
+        variances[c] = model.variance(feature, c);
     }
-
-    // calculate and return specificity
-    return tn / (tn + fp);
+    return { means, variances };
 }
 
-// find the mean value of the given vector
-double mean(vector<double> v1) {
-    double sum = 0;
+/* calculate the probabilities of perishing and surviving for every row of test_data with an
+ * already trained model; the rows are scored in batches, so the training data is not needed
+ */
+vector<vector<double>> calcRawProb(const NaiveBayesModel& model, const TableView& test_data) {
+    // predicted probabilities for surviving and perishing for every observation
+    vector<vector<double>> predicted(test_data.rows());
+
+    const size_t batch = 256;
+    vector<double> rows(batch * 3);
+    vector<double> posteriors(max(batch, (size_t)1) * 2);
+    for (size_t begin = 0; begin < predicted.size(); begin += batch) {
+        size_t n = min(batch, predicted.size() - begin);
+        // pclass, sex and age of every observation of the batch, row after row
+        test_data.gather(PCLASS_COLUMN, begin, n, rows.data(), 3);
+        test_data.gather(SEX_COLUMN, begin, n, rows.data() + 1, 3);
+        test_data.gather(AGE_COLUMN, begin, n, rows.data() + 2, 3);
+        model.predictBatch(rows.data(), n, posteriors.data());
 
-    // find the sum of all values in the vector
-    for (double n : v1) {
-        sum += n;
+        // set the prediction for that observation to the probabilities of perishing and surviving
+        for (size_t i = 0; i < n; i++) {
+            predicted[begin + i] = { posteriors[i * 2], posteriors[i * 2 + 1] };
+        }
     }
 
-    // calculate and return the mean
-    return sum / v1.size();
+    return predicted;
 }
 
-// calculate the variance of the given vector
-double variance(vector<double> v1) {
-    double v1_mean = mean(v1);
-    double sum = 0;
-
-    for (double n : v1) {
-        sum += (n - v1_mean) * (n - v1_mean);
+// print out the values in the given matrix v
+void printProbs(vector<vector<double>> v) {
+    for (int i = 0; i < v[0].size(); i++) {
+        for (int j = 0; j < v.size(); j++) {
+            cout << v[j][i] << " ";
+        }
+        cout << endl;
     }
-
-    double var = sum / (v1.size() - 1);
-    return var;
+    cout << endl;
 }
 
-// calculate likelihood of age (a quantitative variable) using a formula
-double calcAgeLikelihood(double v1, double v1_mean, double v1_var) {
-    double lh_age = 0;
-
-    double part1 = 1 / sqrt(2 * M_PI * v1_var);
-    double squared = (v1 - v1_mean) * (v1 - v1_mean) * -1;
-    lh_age = part1 * exp(squared / (2 * v1_var));
-
-    return lh_age;
+// save the model to a file that --score can load; age_metrics holds the age means and standard deviations
+bool saveModel(const vector<double>& apriori, const vector<vector<double>>& lh_pclass, const vector<vector<double>>& lh_sex,
+    const vector<vector<double>>& age_metrics, const string& path, string& error) {
+    ModelWriter writer(MODEL_NAIVE_BAYES);
+    writer.add("apriori", 1, apriori.size(), apriori.data());
+    writer.add("pclass", lh_pclass);
+    writer.add("sex", lh_sex);
+    writer.add("age", age_metrics);
+    return writer.write(path, error);
 }
 
-/* takes in two vectors and their target values
- * counts the amount of observations that have both of the target values in their
- * respective vectors
-*/
-double getLength(vector<double> v1, double v1_num, vector<double> v2, double v2_num) {
-    int count = 0;
-    for (int i = 0; i < v1.size(); i++) {
-        if (v1_num == v1[i] && v2_num == v2[i]) {
-            count++;
+/* load a saved model once and score rows of pclass,sex,age from stdin (or a Unix socket if
+ * socket_path is set), writing the probability of surviving for every row
+ * batch = most rows scored together
+ */
+int scoreModel(const string& model_path, const string& socket_path, size_t batch) {
+    string error;
+    ModelFile model;
+    if (!model.open(model_path, error)) {
+        cerr << error << endl;
+        return 1;   // 1=error
+    }
+    if (model.kind() != MODEL_NAIVE_BAYES) {
+        cerr << model_path << " is not a naive Bayes model" << endl;
+        return 1;
+    }
+    const double* apriori = model.find("apriori", 1, 2, error);
+    const double* lh_pclass = model.find("pclass", 3, 2, error);
+    const double* lh_sex = model.find("sex", 2, 2, error);
+    const double* age_metrics = model.find("age", 2, 2, error);
+    if (apriori == nullptr || lh_pclass == nullptr || lh_sex == nullptr || age_metrics == nullptr) {
+        cerr << error << endl;
+        return 1;
+    }
+    // rebuild the model from the saved tables once; pclass 0 keeps a likelihood of 0
+    NaiveBayesModel nb(2, { 4, 2 }, 1);
+    for (int c = 0; c < 2; c++) {
+        nb.setPrior(c, apriori[c]);
+        for (int pc = 1; pc <= 3; pc++) {
+            nb.setLikelihood(PCLASS_FEATURE, pc, c, lh_pclass[(pc - 1) * 2 + c]);
         }
+        for (int sx = 0; sx <= 1; sx++) {
+            nb.setLikelihood(SEX_FEATURE, sx, c, lh_sex[sx * 2 + c]);
+        }
+        // the file holds the standard deviations of age; the likelihood needs the variances
+        nb.setGaussian(AGE_FEATURE, c, age_metrics[c], age_metrics[2 + c] * age_metrics[2 + c]);
     }
 
-    return count;
-}
-
-// find the amount of people that survived and perished
-// returns a vector containing {perished_count, survived_count}
-vector<double> getSurvivedCounts(vector<double> survived) {
-    double yes = 0;
-    double no = 0;
-
-    // find the survived and perished counts
-    for (double n : survived) {
-        if (n == 1) {
-            yes++;
-        }
-        else {
-            no++;
+    // rows with a pclass or sex the model has not seen get nan
+    vector<double> posteriors(max(batch, (size_t)1) * 2);
+    auto score = [&](const double* features, size_t n, double* probs) {
+        nb.predictBatch(features, n, posteriors.data());
+        for (size_t r = 0; r < n; r++) {
+            probs[r] = posteriors[r * 2 + 1];
         }
+    };
+    auto report = [](const LatencyReport& latency) {
+        cerr << "scored " << latency.rows << " rows in " << latency.batches << " batches; latency p50 = "
+            << latency.p50 << " us, p99 = " << latency.p99 << " us" << endl;
+    };
+
+    if (!socket_path.empty()) {
+        auto served = [&](const LatencyReport& latency, const string& clientError) {
+            if (!clientError.empty()) {
+                cerr << clientError << endl;
+            }
+            report(latency);
+        };
+        serveUnixSocket(socket_path, 3, batch, score, served, error);
+        cerr << error << endl;
+        return 1;
     }
+    LatencyReport latency;
+    if (!serveScores(0, 1, 3, batch, score, latency, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+    report(latency);
+    return 0;
+}
 
-    return { no, yes };
+/* call f(const T* survived) with the survived values of the rows of data in the view's order
+ * a range of rows is read in place; the labels of a list of rows are gathered first
+ */
+template <typename F>
+void visitSurvived(const TableView& data, F f) {
+    if (data.index() == nullptr) {
+        data.column(SURVIVED_COLUMN).visit(f);
+    }
+    else {
+        vector<double> survived = data.values(SURVIVED_COLUMN);
+        f((const double*)survived.data());
+    }
 }
 
-// calculates the a-priori of the vector survived
-vector<double> getApriori(vector<double> survived) {
-    // gets the survived and perished counts
-    vector<double> counts = getSurvivedCounts(survived);
+// score the probabilities of surviving against the survived column of data
+BinaryMetrics survivedMetrics(const vector<double>& probs, const TableView& data) {
+    BinaryMetrics metrics;
+    visitSurvived(data, [&](const auto* survived) {
+        metrics = evaluateMetrics(probs.data(), survived, probs.size());
+    });
+    return metrics;
+}
 
-    // calculates and returns a-priori
-    return { counts[0] / survived.size(), counts[1] / survived.size() };
+// the ROC curve of the probabilities of surviving against the survived column of data
+RocCurve survivedCurve(const vector<double>& probs, const TableView& data) {
+    RocCurve curve;
+    visitSurvived(data, [&](const auto* survived) {
+        curve = rocCurve(probs.data(), survived, probs.size());
+    });
+    return curve;
 }
 
-// calculates the sex likelihood values; P(sex|survived)
-vector<vector<double>> sexLikelihood(vector<double> survived, vector<double> sex) {
-    // get counts for survived {no, yes}
-    vector<double> counts = getSurvivedCounts(survived);
-
-    // likelihood for sex
-    vector<vector<double>> lh_sex(2, vector<double>(2));
-    // for every survived or perished
-    for (int sv : {0, 1}) {
-        // for every sex (female and male)
-        for (int sx : {0, 1}) {
-            // calculate likelihood
-            lh_sex[sx][sv] = getLength(sex, sx, survived, sv) / counts[sv];
-        }
+/* train and test the model on k folds of data (the columns of titanic_project.csv) with threads
+ * threads and print the mean and standard deviation of the fold scores
+ */
+int runCrossValidation(const TypedTable& data, int k, bool stratify, int threads) {
+    // check every row once so the folds can be trained without checking them again
+    NaiveBayesModel model;
+    string error;
+    if (!trainModel(TableView(data), model, error, threads)) {
+        cout << error << endl;
+        return 1;   // 1=error
     }
 
-    return lh_sex;
-}
-
-// calculates the pclass likelihood values; P(pclass|survived)
-vector<vector<double>> pclassLikelihood(vector<double> survived, vector<double> pclass) {
-    // get counts for survived {no, yes}
-    vector<double> counts = getSurvivedCounts(survived);
-
-    // likelihood for pclass
-    vector<vector<double>> lh_pclass(3, vector<double>(2));
-    // for every survived or perished
-    for (int sv : {0, 1}) {
-        // for every class
-        for (int pc : {1, 2, 3}) {
-            // get likelihood
-            lh_pclass[pc - 1][sv] = getLength(pclass, pc, survived, sv) / counts[sv];
+    vector<Fold> folds;
+    data.columns[SURVIVED_COLUMN].visit([&](const auto* survived) {
+        folds = makeFolds(survived, data.rows, k, stratify, 1);
+    });
+    vector<double> fold_accuracy(folds.size());
+    vector<double> fold_loss(folds.size());
+
+    time_point<system_clock> start = system_clock().now();
+    // every fold is one task of the pool; the folds all read the same data
+    ThreadPool pool(threads);
+    pool.run(folds.size(), [&](size_t f) {
+        // a fold's rows are read in place through its row numbers
+        TableView train(data, folds[f].train);
+        TableView test(data, folds[f].test);
+        NaiveBayesModel fold_model;
+        string fold_error;
+        trainModel(train, fold_model, fold_error);
+        vector<vector<double>> predicted = calcRawProb(fold_model, test);
+        vector<double> probs(predicted.size());
+        for (size_t i = 0; i < predicted.size(); i++) {
+            probs[i] = predicted[i][1];
         }
+        BinaryMetrics metrics = survivedMetrics(probs, test);
+        fold_accuracy[f] = metrics.accuracy();
+        fold_loss[f] = metrics.logLoss();
+    });
+    duration<double> elapsed_time = system_clock().now() - start;
+
+    RunningStats acc;
+    RunningStats loss;
+    for (size_t f = 0; f < folds.size(); f++) {
+        acc.add(fold_accuracy[f]);
+        loss.add(fold_loss[f]);
     }
-
-    return lh_pclass;
+    cout << folds.size() << "-fold " << (stratify ? "stratified " : "") << "cross-validation" << endl;
+    cout << "accuracy = " << acc.mean() << " (sd " << acc.sd() << "), log-loss = " << loss.mean()
+        << " (sd " << loss.sd() << ")" << endl;
+    cout << "elapsed time (seconds) = " << elapsed_time.count() << endl;
+    return 0;
 }
 
-// computes the mean and variance of the vector age since it is a quantitative variable
-// so these are needed to calculate its likelihood
-vector<vector<double>> likelihoodQuan(vector<double> survived, vector<double> age) {
-    vector<double> age_mean = { 0,0 };
-    vector<double> age_variance = { 0,0 };
-
-    // for every survived or perished
-    for (int sv : {0, 1}) {
-        vector<double> temp(age.size());
-        int j = 0;
-        // fill temp with the ages of only the people who survived (when sv=1)/perished (when sv=0)
-        for (int i = 0; i < survived.size(); i++) {
-            if (survived[i] == sv) {
-                temp[j] = age[i];
-                j++;
-            }
-        }
-
-        temp.resize(j);
-
-        // get the mean and variance for the people who survived/perished
-        age_mean[sv] = mean(temp);
-        age_variance[sv] = variance(temp);
+/* the rows as hashed sparse features: "pclass=<value>", "sex=<value>" and "age=<decade>" are
+ * hashed into buckets, each with the value 1
+ */
+SparseMatrix hashRows(const TableView& data, uint32_t buckets) {
+    SparseMatrix x(buckets);
+    for (size_t i = 0; i < data.rows(); i++) {
+        double age = data.value(AGE_COLUMN, i);
+        x.push(featureBucket("pclass=" + to_string((int)data.value(PCLASS_COLUMN, i)), buckets), 1);
+        x.push(featureBucket("sex=" + to_string((int)data.value(SEX_COLUMN, i)), buckets), 1);
+        x.push(featureBucket(isnan(age) ? string("age=NA") : "age=" + to_string((int)(age / 10)), buckets), 1);
+        x.endRow();
     }
-
-    return {age_mean, age_variance};
+    return x;
 }
 
-// calculate raw probabilities
-// calculates the a-priori and likelihoods again
-vector<vector<double>> calcRawProb(vector<vector<double>> train_data, vector<vector<double>> test_data) {    
-    // make naive Bayes model
-    // compute the a-priori, pclass likelihood, sex likelihood, and age means and variances
-    vector<double> apriori = getApriori(train_data[3]);
-    vector<vector<double>> lh_pclass = pclassLikelihood(train_data[3], train_data[0]);
-    vector<vector<double>> lh_sex = sexLikelihood(train_data[3], train_data[1]);
-    vector<vector<double>> age_metrics = likelihoodQuan(train_data[3], train_data[2]);
-
-    // predicted probabilities for surviving and perishing for every observation
-    vector<vector<double>> predicted(test_data[0].size());
-
-    for (int i = 0; i < predicted.size(); i++) {
-        // for every observation
-        double pc = test_data[0][i];
-        double sx = test_data[1][i];
-        double age = test_data[2][i];
-
-        // compute likelihood times prior for survival
-        double num_s = lh_pclass[pc - 1][1] * lh_sex[sx][1] * apriori[1] *
-            calcAgeLikelihood(age, age_metrics[0][1], age_metrics[1][1]);
-
-        // compute likelihood times prior for perishing
-        double num_p = lh_pclass[pc - 1][0] * lh_sex[sx][0] * apriori[0] *
-            calcAgeLikelihood(age, age_metrics[0][0], age_metrics[1][0]);
-
-        double denominator = num_s + num_p;
+/* train a hashed multinomial or Bernoulli model on the train rows and print its metrics on
+ * the test rows; this is the model for sparse inputs with many features, run on the titanic
+ * columns so it can be compared with the Gaussian model
+ */
+int runHashedModel(const TableView& train, const TableView& test, const string& kind_name,
+    uint32_t buckets, int threads) {
+    HashedNaiveBayesKind kind = kind_name == "bernoulli" ? HASHED_BERNOULLI : HASHED_MULTINOMIAL;
+    time_point<system_clock> start = system_clock().now();
+    SparseMatrix train_rows = hashRows(train, buckets);
+    HashedNaiveBayesCounts counts(kind, 2, buckets);
+    string error;
+    vector<double> train_labels = train.values(SURVIVED_COLUMN);
+    if (!countHashedNaiveBayes(train_rows, train_labels, counts, error, threads)) {
+        cout << error << endl;
+        return 1;   // 1=error
+    }
+    HashedNaiveBayesModel model;
+    model.fit(counts);
 
-        // calculate the probabilities of a person surviving or perishing for the observation
-        double prob_survived = num_s / denominator;
-        double prob_perished = num_p / denominator;
+    SparseMatrix test_rows = hashRows(test, buckets);
+    vector<double> posteriors(test_rows.rows() * 2);
+    model.predictBatch(test_rows, posteriors.data(), threads);
+    duration<double> elapsed_time = system_clock().now() - start;
 
-        // set the prediction for that observation to the probabilities of perishing and surviving
-        predicted[i] = { prob_perished, prob_survived };
+    vector<double> probs(test_rows.rows());
+    for (size_t i = 0; i < probs.size(); i++) {
+        probs[i] = posteriors[i * 2 + 1];
     }
-
-    return predicted;
+    BinaryMetrics metrics = survivedMetrics(probs, test);
+    cout << "Hashed " << (kind == HASHED_BERNOULLI ? "Bernoulli" : "multinomial") << " naive Bayes over " << buckets
+        << " buckets (" << counts.features.size() << " seen)" << endl;
+    cout << "accuracy = " << metrics.accuracy() << endl;
+    cout << "sensitivity = " << metrics.recall(0) << endl;
+    cout << "specificity = " << metrics.recall(1) << endl;
+    cout << "auc = " << survivedCurve(probs, test).auc << endl;
+    cout << "log-loss = " << metrics.logLoss() << endl;
+    cout << "elapsed time (seconds) = " << elapsed_time.count() << endl;
+    return 0;
 }
 
-// round the predicted probabilities to 1 or 0
-vector<double> roundProbs(vector<vector<double>> predicted) {
-    vector<double> probs(predicted.size());
-
-    // if a survived probability > 0.5 then set probability to 1; otherwise, set it to 0
-    for (int i = 0; i < predicted.size(); i++) {
-        if (predicted[i][1] > 0.5) {
-            probs[i] = 1;
+int main(int argc, char** argv) {
+    // number of threads used to read the file; can be changed with --threads N
+    // --save-model PATH saves the model; --score PATH loads it and scores pclass,sex,age rows from
+    // stdin (or --socket PATH) in batches of up to --score-batch rows instead of training
+    // --cv K cross-validates the model on K folds of all the rows instead (--stratify 1 keeps the
+    // survived share the same in every fold)
+    // --stats-in A,B,... trains on top of the counts saved by earlier runs or other shards, and
+    // --stats-out PATH saves the counts of everything the model was trained on, so a model can
+    // be updated with new rows, or merged from shards, without reading the old rows again
+    // --hashed multinomial|bernoulli trains the hashed sparse model over --buckets N buckets instead
+    // --train-rows N trains on N rows (800 by default) and tests on the rest; --split first takes the
+    // first N rows, --split shuffle or stratified (classes balanced) picks them at random with --seed
+    int threads = thread::hardware_concurrency();
+    string save_path;
+    string score_path;
+    string socket_path;
+    size_t score_batch = 256;
+    int cv_folds = 0;
+    bool stratify = false;
+    vector<string> stats_in;
+    string stats_out;
+    string hashed;
+    // parsed wider than a bucket index so an out-of-range count is rejected instead of wrapping
+    unsigned long long buckets = 1 << 20;
+    string split_name = "first";
+    size_t train_size = 800;
+    unsigned long seed = 1;
+    for (int i = 1; i < argc - 1; i++) {
+        if (string(argv[i]) == "--threads") {
+            threads = stoi(argv[i + 1]);
         }
-        else {
-            probs[i] = 0;
+        else if (string(argv[i]) == "--save-model") {
+            save_path = argv[i + 1];
         }
-    }
-
-    return probs;
-}
-
-// print out the values in the given matrix v
-void printProbs(vector<vector<double>> v) {
-    for (int i = 0; i < v[0].size(); i++) {
-        for (int j = 0; j < v.size(); j++) {
-            cout << v[j][i] << " ";
+        else if (string(argv[i]) == "--score") {
+            score_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--socket") {
+            socket_path = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--score-batch") {
+            score_batch = stoul(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--cv") {
+            cv_folds = stoi(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--stratify") {
+            stratify = stoi(argv[i + 1]) != 0;
+        }
+        else if (string(argv[i]) == "--stats-in") {
+            stats_in = splitList(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--stats-out") {
+            stats_out = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--hashed") {
+            hashed = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--buckets") {
+            buckets = stoull(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--split") {
+            split_name = argv[i + 1];
+        }
+        else if (string(argv[i]) == "--train-rows") {
+            train_size = stoul(argv[i + 1]);
+        }
+        else if (string(argv[i]) == "--seed") {
+            seed = stoul(argv[i + 1]);
         }
-        cout << endl;
     }
-    cout << endl;
-}
-
-int main(int argc, char** argv) {
-    ifstream inFS;
-    string line;
-    string pclass_in, survived_in, sex_in, age_in;
-    const int MAX_LEN = 1100;
-    vector<double> pclass(MAX_LEN);
-    vector<double> survived(MAX_LEN);
-    vector<double> sex(MAX_LEN);
-    vector<double> age(MAX_LEN);
+    if (split_name != "first" && split_name != "shuffle" && split_name != "stratified") {
+        cout << "Unknown split " << split_name << "; expected first, shuffle or stratified" << endl;
+        return 1;   // 1=error
+    }
+    if (!hashed.empty() && hashed != "multinomial" && hashed != "bernoulli") {
+        cout << "Unknown hashed model " << hashed << "; expected multinomial or bernoulli" << endl;
+        return 1;
+    }
+    // EMPTY_BUCKET marks an empty slot of the bucket table, so it cannot be a bucket index
+    if (buckets < 1 || buckets >= EMPTY_BUCKET) {
+        cout << "Invalid bucket count " << buckets << "; expected 1 to " << EMPTY_BUCKET - 1 << endl;
+        return 1;
+    }
+    if (!score_path.empty()) {
+        return scoreModel(score_path, socket_path, score_batch);
+    }
 
     // attempt to open the file
     cout << "Opening file titanic_project.csv." << endl;
 
-    inFS.open("titanic_project.csv");
-    if (!inFS.is_open()) {
-        cout << "Could not open file" << endl;
+    // the file is memory-mapped and parsed straight into columns of the narrowest type that
+    // holds their values, or read from its binary column cache (titanic_project.csv.cols) if
+    // that was built from the same file
+    // the first column is the row id, which is not used
+    TypedTable table;
+    bool fromCache = false;
+    if (!readTypedCsvCached("titanic_project.csv", table, 1, threads, fromCache)) {
+        cout << table.error << endl;
         return 1;   // 1=error
     }
+    if (fromCache) {
+        cout << "Using cached columns from titanic_project.csv.cols" << endl;
+    }
 
-    // can now use inFS stream like cin stream
     // file titanic_project.csv should contain 4 doubles
+    if (table.columns.size() != 4) {
+        cout << "Expected 4 columns in titanic_project.csv but found " << table.columns.size() << endl;
+        return 1;
+    }
 
     cout << "Reading line 1" << endl;
-    getline(inFS, line);
-
     // echo heading
-    cout << "heading: " << line << endl;
-
-    int numObservations = 0;
-    while (inFS.good()) {
-        getline(inFS, line, ',');
-        // read the data into the corresponding category
-        getline(inFS, pclass_in, ',');
-        getline(inFS, survived_in, ',');
-        getline(inFS, sex_in, ',');
-        getline(inFS, age_in, '\n');
-
-        // convert the data from string to integer
-        pclass.at(numObservations) = stof(pclass_in);
-        survived.at(numObservations) = stof(survived_in);
-        sex.at(numObservations) = stof(sex_in);
-        age.at(numObservations) = stof(age_in);
-
-        numObservations++;
-    }
+    cout << "heading: " << table.headerLine << endl;
 
-    // resize each vector to be an exact fit
-    pclass.resize(numObservations);
-    survived.resize(numObservations);
-    sex.resize(numObservations);
-    age.resize(numObservations);
+    int numObservations = table.rows;
 
-    cout << "new length " << pclass.size() << endl;
+    cout << "new length " << table.rows << endl;
     cout << "Closing file" << endl;
-    inFS.close();
 
     cout << "Number of records: " << numObservations << endl << endl;
 
-    // train data
-    vector<vector<double>> train(4, vector<double>(800));
-    for (int i = 0; i < 800; i++) {
-        train[0][i] = pclass[i];
-        train[1][i] = sex[i];
-        train[2][i] = age[i];
-        train[3][i] = survived[i];
+    if (cv_folds > 0) {
+        return runCrossValidation(table, cv_folds, stratify, threads);
+    }
+
+    // the train and test data are views of the table's rows, so splitting copies no values;
+    // a random split costs two arrays of row numbers
+    size_t train_rows = min(train_size, table.rows);
+    Fold split;
+    if (split_name != "first") {
+        table.columns[SURVIVED_COLUMN].visit([&](const auto* survived) {
+            split = splitRows(survived, table.rows, table.rows - train_rows, split_name == "stratified", seed);
+        });
     }
 
+    // train data
+    TableView train = split_name == "first" ? TableView::range(table, 0, train_rows) : TableView(table, split.train);
+
     // test data
-    int j = 0;
-    vector<vector<double>> test(4, vector<double>(survived.size()-800));
-    for (int i = 800; i < survived.size(); i++) {
-        test[0][j] = pclass[i];
-        test[1][j] = sex[i];
-        test[2][j] = age[i];
-        test[3][j] = survived[i];
-        j++;
+    TableView test = split_name == "first" ? TableView::range(table, train_rows, table.rows) : TableView(table, split.test);
+
+    if (!hashed.empty()) {
+        return runHashedModel(train, test, hashed, (uint32_t)buckets, threads);
     }
 
     time_point<system_clock> start, end;
@@ -403,11 +535,20 @@ int main(int argc, char** argv) {
     start = system_clock().now();
 
     // compute the naive bayes model
+    // one pass over the training rows counts the classes, the pclass and sex values of every
+    // class, and the age stats of every class
+    NaiveBayesModel model;
+    string error;
+    NaiveBayesCounts shards(2, 1);
+    if (!loadShards(stats_in, shards, error) || !trainModel(train, model, error, threads, shards)) {
+        cout << error << endl;
+        return 1;   // 1=error
+    }
     // compute the a-priori, pclass likelihood, sex likelihood, and age means and variances
-    vector<double> apriori = getApriori(train[3]);
-    vector<vector<double>> lh_pclass = pclassLikelihood(train[3], train[0]);
-    vector<vector<double>> lh_sex = sexLikelihood(train[3], train[1]);
-    vector<vector<double>> age_metrics = likelihoodQuan(train[3], train[2]);
+    vector<double> apriori = getApriori(model);
+    vector<vector<double>> lh_pclass = categoryLikelihood(model, PCLASS_FEATURE, 1, 4);
+    vector<vector<double>> lh_sex = categoryLikelihood(model, SEX_FEATURE, 0, 2);
+    vector<vector<double>> age_metrics = likelihoodQuan(model, AGE_FEATURE);
     // calculate the standard deviations from the variances
     age_metrics[1][0] = sqrt(age_metrics[1][0]);
     age_metrics[1][1] = sqrt(age_metrics[1][1]);
@@ -430,35 +571,60 @@ int main(int argc, char** argv) {
     cout << "age" << endl;
     printProbs(age_metrics);
 
-    // compute predicted values from test data
-    vector<vector<double>> predicted = calcRawProb(train, test);
+    if (!save_path.empty()) {
+        string error;
+        if (!saveModel(apriori, lh_pclass, lh_sex, age_metrics, save_path, error)) {
+            cout << error << endl;
+            return 1;
+        }
+        cout << "Model saved to " << save_path << endl << endl;
+    }
+    if (!stats_out.empty()) {
+        string error;
+        if (!saveNaiveBayesCounts(model.statistics(), stats_out, error)) {
+            cout << error << endl;
+            return 1;
+        }
+        cout << "Counts of " << model.statistics().rows() << " rows saved to " << stats_out << endl << endl;
+    }
+
+    // compute predicted values from test data with the model trained above
+    vector<vector<double>> predicted = calcRawProb(model, test);
+    // the probabilities of surviving; one above 0.5 predicts survived
+    vector<double> survived_probs(predicted.size());
+    for (size_t i = 0; i < predicted.size(); i++) {
+        survived_probs[i] = predicted[i][1];
+    }
 
     cout << "Metrics" << endl;
-    // get the rounded probabilities
-    vector<double> probs = roundProbs(predicted);
-    // get accuracy and output it
-    double acc = accuracy(probs, test[3]);
-    cout << "accuracy = " << acc << endl;
+    // one pass over the probabilities gives the confusion matrix and the log-loss
+    BinaryMetrics metrics = survivedMetrics(survived_probs, test);
+    cout << "accuracy = " << metrics.accuracy() << endl;
 
-    // get sensitivity and specificity
-    double sensitive = sensitivity(probs, test[3]);
-    double spec = specificity(probs, test[3]);
+    // class 0 (perished) is the positive class, as in R's confusionMatrix
+    double sensitive = metrics.recall(0);
+    double spec = metrics.recall(1);
 
     // check that sensitivity and specificity are not undefined (NA)
-    if (sensitive == -1) {
+    if (isnan(sensitive)) {
         cout << "sensitivity = NA" << endl;
     }
     else {
         cout << "sensitivity = " << sensitive << endl;
     }
 
-    if (spec == -1) {
+    if (isnan(spec)) {
         cout << "specificity = NA" << endl;
     }
     else {
         cout << "specificity = " << spec << endl;
     }
 
+    // area under the ROC curve over every threshold
+    RocCurve roc = survivedCurve(survived_probs, test);
+    cout << "auc = " << roc.auc << endl;
+    cout << "log-loss = " << metrics.logLoss() << endl;
+
     // output the training time of the algorithm
     cout << "elapsed time (seconds) = " << elapsed_time.count() << endl;
     
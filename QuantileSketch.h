@@ -0,0 +1,218 @@
+/*
+Module Name : Quantile Sketch
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Estimate the median and other quantiles of a column without holding or sorting the whole column
+
+Module Design Description
+KllSketch is a KLL sketch: a stack of compactors where every item on level h stands for 2^h
+original values. When a level fills up it is sorted and every other item is promoted to the
+next level, so memory stays around 3k values no matter how many values are added. With the
+default k = 200 the rank error is about 1.65% (99% confidence) and it shrinks roughly as 1/k.
+Two sketches built over different chunks can be merged into one sketch of the union.
+*/
+
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <vector>
+#include <thread>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include "StreamingStats.h"
+
+class KllSketch {
+public:
+    // k controls the accuracy; larger k means a smaller rank error and more memory
+    explicit KllSketch(int k = 200, uint64_t seed = 1) : k(std::max(k, 8)), rng(seed ? seed : 1) {
+        addLevels(1);
+    }
+
+    // add one value to the sketch
+    void add(double x) {
+        n++;
+        minVal = std::min(minVal, x);
+        maxVal = std::max(maxVal, x);
+        levels[0].push_back(x);
+        if (levels[0].size() >= capacities[0]) {
+            compress();
+        }
+    }
+
+    // combine another sketch into this one; afterwards this sketch summarizes both inputs
+    void merge(const KllSketch& other) {
+        if (other.n == 0) {
+            return;
+        }
+        if (levels.size() < other.levels.size()) {
+            addLevels(other.levels.size());
+        }
+        for (size_t h = 0; h < other.levels.size(); h++) {
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        }
+        n += other.n;
+        minVal = std::min(minVal, other.minVal);
+        maxVal = std::max(maxVal, other.maxVal);
+        compress();
+    }
+
+    // estimate the value at quantile q (0 <= q <= 1)
+    double quantile(double q) const {
+        if (n == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if (q <= 0) {
+            return minVal;
+        }
+        if (q >= 1) {
+            return maxVal;
+        }
+
+        // every retained item carries the weight of the level it lives on
+        std::vector<std::pair<double, uint64_t>> items;
+        for (size_t h = 0; h < levels.size(); h++) {
+            for (double x : levels[h]) {
+                items.push_back({ x, (uint64_t)1 << h });
+            }
+        }
+        std::sort(items.begin(), items.end());
+
+        uint64_t total = 0;
+        for (const auto& item : items) {
+            total += item.second;
+        }
+
+        double target = q * total;
+        uint64_t cumulative = 0;
+        for (const auto& item : items) {
+            cumulative += item.second;
+            if (cumulative >= target) {
+                return item.first;
+            }
+        }
+        return maxVal;
+    }
+
+    double median() const { return quantile(0.5); }
+    uint64_t count() const { return n; }
+
+    // number of values currently held by the sketch
+    size_t retained() const {
+        size_t size = 0;
+        for (const std::vector<double>& level : levels) {
+            size += level.size();
+        }
+        return size;
+    }
+
+private:
+    int k;
+    uint64_t rng;
+    uint64_t n = 0;
+    double minVal = std::numeric_limits<double>::infinity();
+    double maxVal = -std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> levels;
+
+    // capacity of every level, recomputed whenever a level is added
+    std::vector<size_t> capacities;
+    size_t totalCapacity = 0;
+
+    // grow the sketch to the given number of levels; capacities shrink by 2/3 per level going
+    // down from the top one, but never below 2
+    void addLevels(size_t count) {
+        levels.resize(count);
+        capacities.resize(count);
+        totalCapacity = 0;
+        for (size_t h = 0; h < count; h++) {
+            double depth = (double)(count - 1 - h);
+            capacities[h] = std::max((size_t)2, (size_t)std::ceil(k * std::pow(2.0 / 3.0, depth)));
+            totalCapacity += capacities[h];
+        }
+    }
+
+    // xorshift coin flip, deterministic for a given seed so runs are reproducible
+    bool coin() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng & 1;
+    }
+
+    // compact the lowest full level until the sketch fits in its capacity again
+    void compress() {
+        while (retained() > totalCapacity || levels[0].size() >= capacities[0]) {
+            size_t h = 0;
+            while (h < levels.size() && levels[h].size() < capacities[h]) {
+                h++;
+            }
+            if (h == levels.size()) {
+                return;
+            }
+            if (h + 1 == levels.size()) {
+                addLevels(levels.size() + 1);
+            }
+
+            std::vector<double>& level = levels[h];
+            std::sort(level.begin(), level.end());
+
+            // keep one item back when the level has an odd size so no weight is lost
+            double leftover = 0;
+            bool hasLeftover = level.size() % 2 == 1;
+            if (hasLeftover) {
+                leftover = level.back();
+                level.pop_back();
+            }
+
+            // promote every other item, starting at a random offset to keep the estimate unbiased
+            size_t offset = coin() ? 1 : 0;
+            for (size_t i = offset; i < level.size(); i += 2) {
+                levels[h + 1].push_back(level[i]);
+            }
+            level.clear();
+            if (hasLeftover) {
+                level.push_back(leftover);
+            }
+        }
+    }
+};
+
+// build a sketch of a column, one sketch per thread chunk merged at the end
+inline KllSketch collectSketch(const std::vector<double>& v, int k = 200, int threads = 1) {
+    int chunks = statsChunkCount(v.size(), threads);
+    std::vector<KllSketch> partial;
+    for (int c = 0; c < chunks; c++) {
+        partial.emplace_back(k, c + 1);
+    }
+    std::vector<std::thread> workers;
+
+    for (int c = 0; c < chunks; c++) {
+        size_t begin = v.size() * c / chunks;
+        size_t end = v.size() * (c + 1) / chunks;
+        auto work = [&v, &partial, c, begin, end]() {
+            for (size_t i = begin; i < end; i++) {
+                partial[c].add(v[i]);
+            }
+        };
+        if (chunks == 1) {
+            work();
+        }
+        else {
+            workers.emplace_back(work);
+        }
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    for (int c = 1; c < chunks; c++) {
+        partial[0].merge(partial[c]);
+    }
+    return partial[0];
+}
+
+#endif
@@ -0,0 +1,310 @@
+/*
+Module Name : Reduction Kernels
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Sum large vectors quickly, accurately, and with the same result no matter how many threads are used
+
+Module Design Description
+Every reduction here is a sum of (x[i] - mx) * (y[i] - my): a plain sum uses mx = 0 and y = 1,
+a sum of squared deviations uses y = x, and a co-moment uses two columns. The kernel keeps 8
+Kahan-compensated accumulators, with value i going to accumulator i % 8, and adds them up
+in a fixed tree at the end. The AVX-512 kernel holds the 8 accumulators in one register, the
+AVX2 kernel in two, and the scalar kernel in an array, so all three do exactly the same
+arithmetic and give bit-identical results. The kernel is picked at run time from what the CPU
+supports. ML_REDUCTION_ISA=scalar|avx2|avx512 overrides it; a kernel the CPU cannot run, or
+an unknown name, is reported on stderr and the detected kernel is used instead.
+
+For the parallel versions the vector is cut into fixed blocks of REDUCTION_BLOCK values no
+matter how many threads there are. Threads take contiguous ranges of blocks and the block
+results are combined pairwise in a fixed order, so the answer does not depend on the thread
+count either.
+*/
+
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <vector>
+#include <thread>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define REDUCTION_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// values per block in the parallel reductions; 4096 doubles = 32KB, which stays in the L1/L2 cache
+const size_t REDUCTION_BLOCK = 4096;
+// smallest number of blocks worth giving their own thread
+const size_t MIN_BLOCKS_PER_THREAD = 16;
+
+enum ReductionIsa {
+    ISA_SCALAR,
+    ISA_AVX2,
+    ISA_AVX512
+};
+
+/* the compiler may fuse a product and the subtraction that follows it into one FMA instruction,
+ * which rounds differently; passing the product through an empty asm statement stops that so
+ * every kernel and every build rounds the same way
+ */
+#if defined(REDUCTION_DISPATCH)
+#define KEEP_UNFUSED(v) __asm__("" : "+v"(v))
+#else
+#define KEEP_UNFUSED(v)
+#endif
+
+// the 8 running sums and their compensation terms
+struct KahanLanes {
+    double sum[8] = {};
+    double comp[8] = {};
+
+    // add one term to lane l
+    void add(int l, double term) {
+        double y = term - comp[l];
+        double t = sum[l] + y;
+        comp[l] = (t - sum[l]) - y;
+        sum[l] = t;
+    }
+
+    // combine the lanes in a fixed order
+    double total() const {
+        double v[8];
+        for (int l = 0; l < 8; l++) {
+            v[l] = sum[l] - comp[l];
+        }
+        return ((v[0] + v[1]) + (v[2] + v[3])) + ((v[4] + v[5]) + (v[6] + v[7]));
+    }
+};
+
+// scalar kernel over the first n values (n is a multiple of 8); y == nullptr means y = 1
+inline void productLanesScalar(const double* x, const double* y, size_t n, double mx, double my, KahanLanes& lanes) {
+    for (size_t i = 0; i < n; i += 8) {
+        for (int l = 0; l < 8; l++) {
+            double dx = x[i + l] - mx;
+            double dy = y == nullptr ? 1.0 : y[i + l] - my;
+            double term = dx * dy;
+            KEEP_UNFUSED(term);
+            lanes.add(l, term);
+        }
+    }
+}
+
+#if defined(REDUCTION_DISPATCH)
+__attribute__((target("avx2")))
+inline void productLanesAvx2(const double* x, const double* y, size_t n, double mx, double my, KahanLanes& lanes) {
+    __m256d s[2] = { _mm256_loadu_pd(lanes.sum), _mm256_loadu_pd(lanes.sum + 4) };
+    __m256d c[2] = { _mm256_loadu_pd(lanes.comp), _mm256_loadu_pd(lanes.comp + 4) };
+    const __m256d vmx = _mm256_set1_pd(mx);
+    const __m256d vmy = _mm256_set1_pd(my);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    for (size_t i = 0; i < n; i += 8) {
+        for (int h = 0; h < 2; h++) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4 * h), vmx);
+            __m256d dy = y == nullptr ? one : _mm256_sub_pd(_mm256_loadu_pd(y + i + 4 * h), vmy);
+            __m256d term = _mm256_mul_pd(dx, dy);
+            KEEP_UNFUSED(term);
+            __m256d yv = _mm256_sub_pd(term, c[h]);
+            __m256d t = _mm256_add_pd(s[h], yv);
+            c[h] = _mm256_sub_pd(_mm256_sub_pd(t, s[h]), yv);
+            s[h] = t;
+        }
+    }
+
+    _mm256_storeu_pd(lanes.sum, s[0]);
+    _mm256_storeu_pd(lanes.sum + 4, s[1]);
+    _mm256_storeu_pd(lanes.comp, c[0]);
+    _mm256_storeu_pd(lanes.comp + 4, c[1]);
+}
+
+__attribute__((target("avx512f")))
+inline void productLanesAvx512(const double* x, const double* y, size_t n, double mx, double my, KahanLanes& lanes) {
+    __m512d s = _mm512_loadu_pd(lanes.sum);
+    __m512d c = _mm512_loadu_pd(lanes.comp);
+    const __m512d vmx = _mm512_set1_pd(mx);
+    const __m512d vmy = _mm512_set1_pd(my);
+    const __m512d one = _mm512_set1_pd(1.0);
+
+    for (size_t i = 0; i < n; i += 8) {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + i), vmx);
+        __m512d dy = y == nullptr ? one : _mm512_sub_pd(_mm512_loadu_pd(y + i), vmy);
+        __m512d term = _mm512_mul_pd(dx, dy);
+        KEEP_UNFUSED(term);
+        __m512d yv = _mm512_sub_pd(term, c);
+        __m512d t = _mm512_add_pd(s, yv);
+        c = _mm512_sub_pd(_mm512_sub_pd(t, s), yv);
+        s = t;
+    }
+
+    _mm512_storeu_pd(lanes.sum, s);
+    _mm512_storeu_pd(lanes.comp, c);
+}
+#endif
+
+// pick the widest kernel the CPU supports, unless ML_REDUCTION_ISA says otherwise
+// an override the CPU cannot run, or does not recognize, is reported and ignored
+inline ReductionIsa detectReductionIsa() {
+    const char* forced = std::getenv("ML_REDUCTION_ISA");
+    ReductionIsa best = ISA_SCALAR;
+#if defined(REDUCTION_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        best = ISA_AVX512;
+    }
+    else if (__builtin_cpu_supports("avx2")) {
+        best = ISA_AVX2;
+    }
+#endif
+    if (forced == nullptr || *forced == '\0') {
+        return best;
+    }
+    std::string name = forced;
+    ReductionIsa wanted;
+    if (name == "scalar") {
+        wanted = ISA_SCALAR;
+    }
+    else if (name == "avx2") {
+        wanted = ISA_AVX2;
+    }
+    else if (name == "avx512") {
+        wanted = ISA_AVX512;
+    }
+    else {
+        std::cerr << "Unknown ML_REDUCTION_ISA " << name << "; expected scalar, avx2 or avx512" << std::endl;
+        return best;
+    }
+    // never pick a kernel the CPU cannot run
+    if (wanted > best) {
+        std::cerr << "ML_REDUCTION_ISA " << name << " is not supported by this CPU" << std::endl;
+        return best;
+    }
+    return wanted;
+}
+
+inline ReductionIsa reductionIsa() {
+    static const ReductionIsa isa = detectReductionIsa();
+    return isa;
+}
+
+inline const char* reductionIsaName() {
+    switch (reductionIsa()) {
+    case ISA_AVX512:
+        return "avx512";
+    case ISA_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+/* compensated sum of (x[i] - mx) * (y[i] - my) over n values on one thread
+ * y == nullptr sums (x[i] - mx) instead
+ */
+inline double productSum(const double* x, const double* y, size_t n, double mx = 0, double my = 0) {
+    KahanLanes lanes;
+    size_t body = n / 8 * 8;
+
+    switch (reductionIsa()) {
+#if defined(REDUCTION_DISPATCH)
+    case ISA_AVX512:
+        productLanesAvx512(x, y, body, mx, my, lanes);
+        break;
+    case ISA_AVX2:
+        productLanesAvx2(x, y, body, mx, my, lanes);
+        break;
+#endif
+    default:
+        productLanesScalar(x, y, body, mx, my, lanes);
+        break;
+    }
+
+    // the leftover values go to the same lanes they would in a longer vector
+    for (size_t i = body; i < n; i++) {
+        double dx = x[i] - mx;
+        double dy = y == nullptr ? 1.0 : y[i] - my;
+        double term = dx * dy;
+        KEEP_UNFUSED(term);
+        lanes.add((int)(i % 8), term);
+    }
+    return lanes.total();
+}
+
+// add up a list of partial results pairwise, always in the same tree
+inline double pairwiseTotal(const double* v, size_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    if (n == 1) {
+        return v[0];
+    }
+    size_t half = n / 2;
+    return pairwiseTotal(v, half) + pairwiseTotal(v + half, n - half);
+}
+
+/* run work(block) for every block index, splitting the blocks into contiguous ranges over threads
+ * small inputs stay on the calling thread
+ */
+template <typename Work>
+void forEachBlock(size_t blocks, int threads, Work work) {
+    size_t workers = std::min((size_t)std::max(threads, 1), blocks / MIN_BLOCKS_PER_THREAD);
+    if (workers <= 1) {
+        for (size_t b = 0; b < blocks; b++) {
+            work(b);
+        }
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < workers; w++) {
+        pool.emplace_back([&, w]() {
+            for (size_t b = blocks * w / workers; b < blocks * (w + 1) / workers; b++) {
+                work(b);
+            }
+        });
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+// deterministic parallel sum of (x[i] - mx) * (y[i] - my); y == nullptr sums x[i] - mx
+inline double reduceProducts(const double* x, const double* y, size_t n, double mx, double my, int threads) {
+    size_t blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    std::vector<double> partial(blocks);
+    forEachBlock(blocks, threads, [&](size_t b) {
+        size_t begin = b * REDUCTION_BLOCK;
+        size_t len = std::min(REDUCTION_BLOCK, n - begin);
+        partial[b] = productSum(x + begin, y == nullptr ? nullptr : y + begin, len, mx, my);
+    });
+    return pairwiseTotal(partial.data(), blocks);
+}
+
+// sum of a vector
+inline double reduceSum(const std::vector<double>& v, int threads = 1) {
+    return reduceProducts(v.data(), nullptr, v.size(), 0, 0, threads);
+}
+
+inline double reduceMean(const std::vector<double>& v, int threads = 1) {
+    return reduceSum(v, threads) / v.size();
+}
+
+// sample variance (two passes: the mean, then the squared deviations from it)
+inline double reduceVariance(const std::vector<double>& v, int threads = 1) {
+    double m = reduceMean(v, threads);
+    return reduceProducts(v.data(), v.data(), v.size(), m, m, threads) / (v.size() - 1);
+}
+
+// sample covariance of two equal-length vectors
+inline double reduceCovariance(const std::vector<double>& x, const std::vector<double>& y, int threads = 1) {
+    double mx = reduceMean(x, threads);
+    double my = reduceMean(y, threads);
+    return reduceProducts(x.data(), y.data(), x.size(), mx, my, threads) / (x.size() - 1);
+}
+
+#endif
@@ -0,0 +1,272 @@
+/*
+Module Name : Scoring Server
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Score rows with an already trained model as they arrive on standard input or a local Unix
+socket, writing one probability per row back, and report how long the scoring took
+
+Module Design Description
+serveScores reads whatever bytes have arrived into a fixed buffer, cuts them into lines, and
+parses every line as width comma-separated numbers straight into a preallocated batch. All
+the complete lines that arrived together (up to maxBatch of them) are scored as one micro-
+batch by the score function, and the probabilities are formatted into a preallocated output
+buffer and written back with one write call, so a busy client gets large batches and a quiet
+one still gets an answer for every line right away. A line that cannot be parsed gets "nan"
+so the answers stay in step with the rows. The latency of every batch (from the read that
+completed it to the end of the write) is recorded and the 50th and 99th percentiles are
+reported when the input ends. serveUnixSocket listens on a socket path and serves one client
+at a time, reporting the latencies and any error after every client. Replies to a socket are
+sent with MSG_NOSIGNAL, so a client that disconnects before reading them only ends its own
+session instead of killing the server with SIGPIPE. An existing file at the socket path is
+only replaced if it is itself a socket. Only POSIX systems are supported.
+*/
+
+#ifndef SCORING_SERVER_H
+#define SCORING_SERVER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <algorithm>
+#include "CsvReader.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+// bytes read at a time; a longer line makes the buffer grow
+const size_t SCORE_READ_BUFFER = 1 << 16;
+// most characters one formatted probability and its newline take
+const size_t SCORE_NUMBER_WIDTH = 32;
+
+struct LatencyReport {
+    size_t rows = 0;
+    size_t batches = 0;
+    // batch latencies in microseconds
+    double p50 = 0;
+    double p99 = 0;
+};
+
+// the q-th quantile of the values (reorders them)
+inline double latencyQuantile(std::vector<double>& values, double q) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t k = std::min(values.size() - 1, (size_t)(q * values.size()));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+#if !defined(_WIN32)
+/* write all n bytes, retrying short and interrupted writes; returns false with errno set if
+ * the other side went away
+ * a socket is written with send(MSG_NOSIGNAL) so a closed peer is an error instead of SIGPIPE
+ */
+inline bool writeAll(int fd, const char* data, size_t n) {
+    bool isSocket = true;
+    while (n > 0) {
+        ssize_t written = isSocket ? ::send(fd, data, n, MSG_NOSIGNAL) : ::write(fd, data, n);
+        if (written < 0 && isSocket && errno == ENOTSOCK) {
+            isSocket = false;
+            continue;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        n -= (size_t)written;
+    }
+    return true;
+}
+
+/* read rows of width comma-separated numbers from inFd until it ends and write one probability
+ * per row to outFd; score(features, rows, probs) fills probs[0..rows) from rows x width features
+ * returns false with error set if reading or writing fails
+ */
+template <typename Score>
+bool serveScores(int inFd, int outFd, size_t width, size_t maxBatch, Score score, LatencyReport& report,
+    std::string& error) {
+    maxBatch = std::max(maxBatch, (size_t)1);
+    std::vector<char> input(SCORE_READ_BUFFER);
+    std::vector<double> features(maxBatch * width);
+    std::vector<double> probs(maxBatch);
+    std::vector<char> output(maxBatch * SCORE_NUMBER_WIDTH);
+    // rows of the batch that could not be parsed
+    std::vector<size_t> invalid;
+    invalid.reserve(maxBatch);
+    std::vector<double> latencies;
+    latencies.reserve(1 << 16);
+    report = LatencyReport();
+
+    size_t pending = 0;
+    bool ended = false;
+    while (!ended) {
+        if (pending == input.size()) {
+            input.resize(input.size() * 2);
+        }
+        ssize_t got = ::read(inFd, input.data() + pending, input.size() - pending);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            error = std::string("Could not read the input: ") + strerror(errno);
+            return false;
+        }
+        auto arrived = std::chrono::steady_clock::now();
+        ended = got == 0;
+        size_t available = pending + (size_t)got;
+
+        // the complete lines, plus the last line without a newline once the input has ended
+        const char* begin = input.data();
+        const char* end = input.data() + available;
+        const char* last = end;
+        if (!ended) {
+            last = begin;
+            for (const char* p = end; p > begin; p--) {
+                if (p[-1] == '\n') {
+                    last = p;
+                    break;
+                }
+            }
+        }
+
+        const char* line = begin;
+        while (line < last) {
+            // fill one batch
+            size_t rows = 0;
+            invalid.clear();
+            while (line < last && rows < maxBatch) {
+                const char* lineEnd = std::find(line, last, '\n');
+                if (lineEnd == line || (lineEnd == line + 1 && *line == '\r')) {
+                    line = lineEnd + (lineEnd < last);
+                    continue;
+                }
+                // parse exactly width fields
+                double* row = features.data() + rows * width;
+                const char* field = line;
+                bool ok = true;
+                for (size_t c = 0; c < width && ok; c++) {
+                    const char* fieldEnd = std::find(field, lineEnd, ',');
+                    ok = parseField(field, fieldEnd, row[c]) && (c + 1 < width ? fieldEnd < lineEnd : fieldEnd == lineEnd);
+                    field = fieldEnd + 1;
+                }
+                if (!ok) {
+                    invalid.push_back(rows);
+                    std::fill(row, row + width, 0.0);
+                }
+                rows++;
+                line = lineEnd + (lineEnd < last);
+            }
+            if (rows == 0) {
+                break;
+            }
+
+            score(features.data(), rows, probs.data());
+            for (size_t r : invalid) {
+                probs[r] = NAN;
+            }
+
+            char* out = output.data();
+            for (size_t r = 0; r < rows; r++) {
+                if (std::isnan(probs[r])) {
+                    memcpy(out, "nan", 3);
+                    out += 3;
+                }
+                else {
+                    out = std::to_chars(out, output.data() + output.size(), probs[r]).ptr;
+                }
+                *out++ = '\n';
+            }
+            if (!writeAll(outFd, output.data(), out - output.data())) {
+                error = std::string("Could not write the scores: ") + strerror(errno);
+                return false;
+            }
+
+            std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - arrived;
+            latencies.push_back(latency.count());
+            report.rows += rows;
+            report.batches++;
+        }
+
+        // keep the incomplete last line for the next read
+        pending = end - last;
+        memmove(input.data(), last, pending);
+    }
+
+    report.p50 = latencyQuantile(latencies, 0.50);
+    report.p99 = latencyQuantile(latencies, 0.99);
+    return true;
+}
+
+/* listen on the Unix socket at path and serve one client at a time with serveScores, calling
+ * done(report, clientError) after every client, with clientError empty if the client was served
+ * only returns (false, with error set) if the socket fails
+ */
+template <typename Score, typename Done>
+bool serveUnixSocket(const std::string& path, size_t width, size_t maxBatch, Score score, Done done, std::string& error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = "Socket path " + path + " is too long";
+        return false;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        error = std::string("Could not create a socket: ") + strerror(errno);
+        return false;
+    }
+    // a socket file left behind by an earlier run would make bind fail; anything else is kept
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            error = "Could not listen on " + path + ": the path exists and is not a socket";
+            close(listener);
+            return false;
+        }
+        unlink(path.c_str());
+    }
+    if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        error = std::string("Could not listen on ") + path + ": " + strerror(errno);
+        close(listener);
+        return false;
+    }
+
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("Could not accept a client: ") + strerror(errno);
+            close(listener);
+            return false;
+        }
+        LatencyReport report;
+        std::string clientError;
+        serveScores(client, client, width, maxBatch, score, report, clientError);
+        close(client);
+        done(report, clientError);
+    }
+}
+#endif
+
+#endif
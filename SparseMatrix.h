@@ -0,0 +1,146 @@
+/*
+Module Name : Sparse Matrix
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Store feature matrices that are mostly zeros (one-hot categoricals, hashed ids) in memory
+proportional to the number of non-zero values
+
+Module Design Description
+SparseMatrix is in compressed sparse row (CSR) form: the non-zero values of all rows one after
+another, the column of every value, and where each row starts. Rows are built one at a time
+with push(column, value) and endRow(); a row's values are kept sorted by column. transpose()
+counts the values per column and places them in one pass, and because the transpose of a CSR
+matrix is the same matrix in compressed sparse column (CSC) form, the same class serves for
+both: row i of x.transpose() is column i of x. Column numbers are 32-bit to halve the index
+memory, which allows up to 4 billion (hashed) features.
+*/
+
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <numeric>
+#include <algorithm>
+#include "Matrix.h"
+
+class SparseMatrix {
+public:
+    // an empty matrix with the given number of columns; rows are added with push and endRow
+    explicit SparseMatrix(size_t cols = 0) : nCols(cols) {
+        starts.push_back(0);
+    }
+
+    // add a value to the row being built; zeros are skipped
+    void push(uint32_t col, double value) {
+        if (value != 0) {
+            columns.push_back(col);
+            entries.push_back(value);
+            nCols = std::max(nCols, (size_t)col + 1);
+        }
+    }
+
+    // finish the row being built
+    void endRow() {
+        size_t begin = starts.back();
+        if (!std::is_sorted(columns.begin() + begin, columns.end())) {
+            sortRow(begin);
+        }
+        starts.push_back(columns.size());
+    }
+
+    size_t rows() const { return starts.size() - 1; }
+    size_t cols() const { return nCols; }
+    size_t nonZeros() const { return entries.size(); }
+
+    // the values of row i are entries [rowBegin(i), rowEnd(i))
+    size_t rowBegin(size_t i) const { return starts[i]; }
+    size_t rowEnd(size_t i) const { return starts[i + 1]; }
+    const uint32_t* columnIndex() const { return columns.data(); }
+    const double* values() const { return entries.data(); }
+    const size_t* rowStarts() const { return starts.data(); }
+
+    // dot product of row i with a dense vector
+    double rowDot(size_t i, const double* w) const {
+        double z = 0;
+        for (size_t k = starts[i]; k < starts[i + 1]; k++) {
+            z += entries[k] * w[columns[k]];
+        }
+        return z;
+    }
+
+    // the same matrix with rows and columns swapped (the CSC form of this matrix)
+    SparseMatrix transpose() const {
+        SparseMatrix t(rows());
+        t.starts.assign(nCols + 1, 0);
+        for (uint32_t c : columns) {
+            t.starts[c + 1]++;
+        }
+        std::partial_sum(t.starts.begin(), t.starts.end(), t.starts.begin());
+
+        // walking the rows in order leaves every column of the transpose sorted
+        t.columns.resize(columns.size());
+        t.entries.resize(entries.size());
+        std::vector<size_t> next(t.starts.begin(), t.starts.end() - 1);
+        for (size_t i = 0; i < rows(); i++) {
+            for (size_t k = starts[i]; k < starts[i + 1]; k++) {
+                size_t to = next[columns[k]]++;
+                t.columns[to] = (uint32_t)i;
+                t.entries[to] = entries[k];
+            }
+        }
+        return t;
+    }
+
+private:
+    std::vector<size_t> starts;
+    std::vector<uint32_t> columns;
+    std::vector<double> entries;
+    size_t nCols;
+
+    // sort the values of the row starting at begin by column
+    void sortRow(size_t begin) {
+        size_t len = columns.size() - begin;
+        std::vector<size_t> order(len);
+        std::iota(order.begin(), order.end(), (size_t)0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return columns[begin + a] < columns[begin + b]; });
+        std::vector<uint32_t> sortedColumns(len);
+        std::vector<double> sortedEntries(len);
+        for (size_t k = 0; k < len; k++) {
+            sortedColumns[k] = columns[begin + order[k]];
+            sortedEntries[k] = entries[begin + order[k]];
+        }
+        std::copy(sortedColumns.begin(), sortedColumns.end(), columns.begin() + begin);
+        std::copy(sortedEntries.begin(), sortedEntries.end(), entries.begin() + begin);
+    }
+};
+
+// the non-zero values of a dense matrix in sparse form
+inline SparseMatrix toSparse(const Matrix& x) {
+    SparseMatrix s(x.cols());
+    for (size_t i = 0; i < x.rows(); i++) {
+        for (size_t j = 0; j < x.cols(); j++) {
+            s.push((uint32_t)j, x(i, j));
+        }
+        s.endRow();
+    }
+    return s;
+}
+
+// the non-zero values of a view of a dense matrix (including its intercept column) in sparse form
+inline SparseMatrix toSparse(const RowView& x) {
+    SparseMatrix s(x.cols());
+    for (size_t i = 0; i < x.rows(); i++) {
+        double value;
+        for (size_t j = 0; j < x.cols(); j++) {
+            s.push((uint32_t)j, *x.gather(j, i, 1, &value));
+        }
+        s.endRow();
+    }
+    return s;
+}
+
+#endif
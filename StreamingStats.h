@@ -0,0 +1,240 @@
+/*
+Module Name : Streaming Statistics
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Compute the basic statistics of numeric columns in a single pass over the data
+
+Module Design Description
+RunningStats keeps the count, sum, mean, sum of squared deviations (Welford), min and max of
+one column. PairStats keeps the same for two columns plus their co-moment so the covariance
+and correlation come out of the same scan. Both can be merged, so a column can be split into
+chunks, each chunk accumulated on its own thread, and the partial results combined at the end.
+collectStats and collectPairStats cut a column into fixed blocks that fit in cache, summarize
+each block with the compensated SIMD kernels from Reduction.h, and merge the blocks in order,
+so their results do not depend on the number of threads. Every product that is added to a
+running total goes through KEEP_UNFUSED first, so a build that allows FMA contraction (such as
+-march=native) rounds the same way as one that does not.
+*/
+
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include "Reduction.h"
+
+// single-pass accumulator for one numeric column
+struct RunningStats {
+    long long count = 0;
+    double total = 0;
+    double avg = 0;
+    // sum of squared deviations from the running mean
+    double m2 = 0;
+    double minVal = std::numeric_limits<double>::infinity();
+    double maxVal = -std::numeric_limits<double>::infinity();
+
+    // add one value to the accumulator
+    void add(double x) {
+        count++;
+        total += x;
+        double delta = x - avg;
+        avg += delta / count;
+        double spread = delta * (x - avg);
+        KEEP_UNFUSED(spread);
+        m2 += spread;
+        if (x < minVal) {
+            minVal = x;
+        }
+        if (x > maxVal) {
+            maxVal = x;
+        }
+    }
+
+    // combine the stats of another chunk into this one (Chan et al. parallel update)
+    void merge(const RunningStats& other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+
+        long long n = count + other.count;
+        double delta = other.avg - avg;
+        double spread = delta * delta * ((double)count * other.count / n);
+        KEEP_UNFUSED(spread);
+        m2 += other.m2 + spread;
+        avg += delta * other.count / n;
+        total += other.total;
+        count = n;
+        minVal = std::min(minVal, other.minVal);
+        maxVal = std::max(maxVal, other.maxVal);
+    }
+
+    double sum() const { return total; }
+    double mean() const { return avg; }
+    double range() const { return maxVal - minVal; }
+
+    // sample variance, same as var() in R
+    double variance() const {
+        return count > 1 ? m2 / (count - 1) : 0;
+    }
+
+    double sd() const { return std::sqrt(variance()); }
+};
+
+// single-pass accumulator for a pair of numeric columns
+struct PairStats {
+    RunningStats x;
+    RunningStats y;
+    // sum of products of deviations from the running means
+    double c2 = 0;
+
+    // add one (x, y) observation
+    void add(double xv, double yv) {
+        // the x mean has to be updated before the co-moment and the y mean after it
+        double dy = yv - y.avg;
+        x.add(xv);
+        double product = (xv - x.avg) * dy;
+        KEEP_UNFUSED(product);
+        c2 += product;
+        y.add(yv);
+    }
+
+    // combine the stats of another chunk into this one
+    void merge(const PairStats& other) {
+        if (other.x.count == 0) {
+            return;
+        }
+        if (x.count == 0) {
+            *this = other;
+            return;
+        }
+
+        double n = (double)(x.count + other.x.count);
+        double dx = other.x.avg - x.avg;
+        double dy = other.y.avg - y.avg;
+        double product = dx * dy * ((double)x.count * other.x.count / n);
+        KEEP_UNFUSED(product);
+        c2 += other.c2 + product;
+        x.merge(other.x);
+        y.merge(other.y);
+    }
+
+    // sample covariance, same as cov() in R
+    double covariance() const {
+        return x.count > 1 ? c2 / (x.count - 1) : 0;
+    }
+
+    // pearson correlation, same as cor() in R
+    double correlation() const {
+        return covariance() / (x.sd() * y.sd());
+    }
+};
+
+// smallest chunk worth giving its own thread; below this the thread startup costs more than the scan
+const size_t MIN_STATS_CHUNK = 1 << 16;
+
+// number of chunks to split n values into for the given thread count
+inline int statsChunkCount(size_t n, int threads) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    size_t chunks = std::min((size_t)threads, n / MIN_STATS_CHUNK);
+    return chunks < 1 ? 1 : (int)chunks;
+}
+
+// summarize one block of values; the block is small enough that the second pass hits the cache
+inline RunningStats blockStats(const double* x, size_t n) {
+    RunningStats stats;
+    if (n == 0) {
+        return stats;
+    }
+
+    stats.count = n;
+    stats.total = productSum(x, nullptr, n);
+    stats.avg = stats.total / n;
+    stats.m2 = productSum(x, x, n, stats.avg, stats.avg);
+    for (size_t i = 0; i < n; i++) {
+        stats.minVal = std::min(stats.minVal, x[i]);
+        stats.maxVal = std::max(stats.maxVal, x[i]);
+    }
+    return stats;
+}
+
+// n values as doubles: doubles are used in place, other types are copied into buffer
+template <typename T>
+const double* widenBlock(const T* values, size_t n, double* buffer) {
+    if constexpr (std::is_same<T, double>::value) {
+        return values;
+    }
+    for (size_t i = 0; i < n; i++) {
+        buffer[i] = (double)values[i];
+    }
+    return buffer;
+}
+
+/* the stats of n values of any numeric type, splitting them across threads when there are enough
+ * the blocks are merged in order so the result does not depend on the thread count; values that
+ * are not doubles are widened one block at a time into a buffer, so they are only read once
+ */
+template <typename T>
+RunningStats collectStats(const T* values, size_t n, int threads = 1) {
+    size_t blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    std::vector<RunningStats> partial(blocks);
+    forEachBlock(blocks, threads, [&](size_t b) {
+        size_t begin = b * REDUCTION_BLOCK;
+        size_t len = std::min(REDUCTION_BLOCK, n - begin);
+        double buffer[REDUCTION_BLOCK];
+        partial[b] = blockStats(widenBlock(values + begin, len, buffer), len);
+    });
+
+    RunningStats result;
+    for (const RunningStats& p : partial) {
+        result.merge(p);
+    }
+    return result;
+}
+
+// accumulate the stats of a column, splitting it across threads when it is large enough
+inline RunningStats collectStats(const std::vector<double>& v, int threads = 1) {
+    return collectStats(v.data(), v.size(), threads);
+}
+
+// accumulate the stats of n pairs of values of any numeric types and their co-moment in one scan
+template <typename X, typename Y>
+PairStats collectPairStats(const X* x, const Y* y, size_t n, int threads = 1) {
+    size_t blocks = (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+    std::vector<PairStats> partial(blocks);
+    forEachBlock(blocks, threads, [&](size_t b) {
+        size_t begin = b * REDUCTION_BLOCK;
+        size_t len = std::min(REDUCTION_BLOCK, n - begin);
+        double xBuffer[REDUCTION_BLOCK];
+        double yBuffer[REDUCTION_BLOCK];
+        const double* xs = widenBlock(x + begin, len, xBuffer);
+        const double* ys = widenBlock(y + begin, len, yBuffer);
+        PairStats& stats = partial[b];
+        stats.x = blockStats(xs, len);
+        stats.y = blockStats(ys, len);
+        stats.c2 = productSum(xs, ys, len, stats.x.avg, stats.y.avg);
+    });
+
+    PairStats result;
+    for (const PairStats& p : partial) {
+        result.merge(p);
+    }
+    return result;
+}
+
+// accumulate the stats of two equal-length columns and their co-moment in one scan
+inline PairStats collectPairStats(const std::vector<double>& x, const std::vector<double>& y, int threads = 1) {
+    return collectPairStats(x.data(), y.data(), std::min(x.size(), y.size()), threads);
+}
+
+#endif
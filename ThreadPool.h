@@ -0,0 +1,144 @@
+/*
+Module Name : Thread Pool
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Keep a set of worker threads alive so loops that run many times (like a training loop) can
+split each iteration across cores without starting new threads every time
+
+Module Design Description
+run(tasks, task) hands out the task numbers 0..tasks-1 through a shared atomic counter. The
+workers and the calling thread all take task numbers until none are left, and run returns
+once every task has finished and every worker has seen the run and left it, so a worker that
+woke late can never take a task number of the next run. The calling thread always takes part,
+so a pool of size 1 has no worker threads at all and simply runs the tasks in order.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+class ThreadPool {
+public:
+    // threads = total number of threads including the caller; values below 1 mean 1
+    explicit ThreadPool(int threads) {
+        for (int i = 1; i < threads; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    // number of threads that run tasks, including the caller
+    int size() const { return (int)workers.size() + 1; }
+
+    // run task(0) .. task(tasks - 1) across the pool and wait for all of them
+    void run(size_t tasks, const std::function<void(size_t)>& task) {
+        if (tasks == 0) {
+            return;
+        }
+        if (workers.empty() || tasks == 1) {
+            for (size_t t = 0; t < tasks; t++) {
+                task(t);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &task;
+            total = tasks;
+            next = 0;
+            finished = 0;
+            arrived = 0;
+            generation++;
+        }
+        wake.notify_all();
+
+        runTasks();
+
+        /* also wait until every worker has joined this run and left runTasks, so none of them is
+         * still reading this task or its counters when the next run resets them
+         */
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return finished == total && arrived == workers.size() && active == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::atomic<const std::function<void(size_t)>*> current{ nullptr };
+    std::atomic<size_t> total{ 0 };
+    std::atomic<size_t> next{ 0 };
+    size_t finished = 0;
+    // workers currently inside runTasks
+    int active = 0;
+    // workers that have joined the current run
+    size_t arrived = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    // take task numbers until there are none left
+    void runTasks() {
+        size_t ran = 0;
+        for (size_t t = next++; t < total; t = next++) {
+            (*current.load())(t);
+            ran++;
+        }
+        if (ran > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished += ran;
+            if (finished == total) {
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop() {
+        unsigned long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                arrived++;
+                active++;
+            }
+            runTasks();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+                if (active == 0) {
+                    done.notify_all();
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,700 @@
+/*
+Module Name : Typed Columns
+Date : 2026 - 10 - 17
+Author : Naomi Zilber
+
+Module Purpose
+Keep the columns of a CSV file in the smallest type that holds their values exactly (uint8,
+int32, float or double) and text columns as dictionary codes, working out the types from the
+file itself, so small integer and categorical columns take up to 8 times less memory and
+bandwidth than doubles
+
+Module Design Description
+A TypedColumn stores its values in one vector of its type. A categorical column stores codes
+(uint8 while it has at most 256 levels, int32 after that) and a dictionary from code to text,
+with the levels numbered in the order they first appear. ColumnShape sums up what the values of
+a column need (are they all whole numbers, their range, are they all exact as floats), and the
+type of a numeric column is a function of its shape only: uint8 for whole numbers 0..255, int32
+for other whole numbers that fit, float if every value is exactly a float, double otherwise.
+ColumnBuilder reads one field at a time: a number widens the column if its shape now needs a
+wider type, a field that is not a number (an empty field or NA is a missing number, nan) makes
+the column categorical, and the numbers read before it become levels. A number in a
+categorical column, before or after the first text, gets its shortest text as its level (3.0
+and 3 are both "3", an empty field and NA are both "NA"), so the levels do not depend on where
+the column turned categorical. readTypedCsv scans the
+file with the same delimiter scanner as readCsv. Large files are cut into byte ranges that are
+read on separate threads; the pieces are joined by working out every column's final type from
+the merged shapes (or merging the dictionaries in file order), then every thread converts its
+own piece into place, so the types, codes and values are the same for any number of threads.
+Code that works on any column type takes a ColumnRef (a type, a pointer and a length) and calls
+visit with a generic lambda, which is instantiated once per type; the lambda sees a plain typed
+array, so the loops over it are as tight as the double versions.
+A column can also be read in place from memory it does not own (a memory-mapped column cache,
+see ColumnCache.h); the table then holds on to that memory through its storage pointer, so the
+columns stay valid for as long as any copy of the table does.
+A TableView is some of the rows of a TypedTable, a range of them or a list of row numbers
+(a shuffled split or a fold), so splitting a table costs at most an index array; a range of a
+column is a ColumnRef into the middle of it, and a list is read through the row numbers.
+*/
+
+#ifndef TYPED_COLUMNS_H
+#define TYPED_COLUMNS_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include "CsvReader.h"
+#include "StreamingStats.h"
+
+// the type of the values of a column; the numbers are stored in column cache files
+enum ColumnType : uint32_t {
+    COLUMN_DOUBLE = 0,
+    COLUMN_FLOAT = 1,
+    COLUMN_INT32 = 2,
+    COLUMN_UINT8 = 3
+};
+
+// most levels a categorical column can keep in uint8 codes
+const size_t UINT8_LEVELS = 256;
+
+inline const char* columnTypeName(ColumnType type) {
+    switch (type) {
+    case COLUMN_FLOAT:
+        return "float";
+    case COLUMN_INT32:
+        return "int32";
+    case COLUMN_UINT8:
+        return "uint8";
+    default:
+        return "double";
+    }
+}
+
+inline size_t columnTypeSize(ColumnType type) {
+    switch (type) {
+    case COLUMN_FLOAT:
+    case COLUMN_INT32:
+        return 4;
+    case COLUMN_UINT8:
+        return 1;
+    default:
+        return 8;
+    }
+}
+
+// what the values of a numeric column need, which decides its type
+struct ColumnShape {
+    // every value is a whole number in the int32 range
+    bool integral = true;
+    // every value is exactly a float
+    bool floatExact = true;
+    double minVal = std::numeric_limits<double>::infinity();
+    double maxVal = -std::numeric_limits<double>::infinity();
+
+    void add(double v) {
+        integral = integral && v >= INT32_MIN && v <= INT32_MAX && (double)(int32_t)v == v;
+        // a float holds a missing value (NaN) as well as a double does
+        floatExact = floatExact && (std::isnan(v) || (double)(float)v == v);
+        minVal = std::min(minVal, v);
+        maxVal = std::max(maxVal, v);
+    }
+
+    void merge(const ColumnShape& other) {
+        integral = integral && other.integral;
+        floatExact = floatExact && other.floatExact;
+        minVal = std::min(minVal, other.minVal);
+        maxVal = std::max(maxVal, other.maxVal);
+    }
+
+    // the smallest type that holds every value exactly
+    ColumnType type() const {
+        if (integral && minVal >= 0 && maxVal <= 255) {
+            return COLUMN_UINT8;
+        }
+        if (integral) {
+            return COLUMN_INT32;
+        }
+        return floatExact ? COLUMN_FLOAT : COLUMN_DOUBLE;
+    }
+};
+
+class TypedColumn;
+
+// a read-only view of a column of any type
+struct ColumnRef {
+    ColumnType type = COLUMN_DOUBLE;
+    const void* values = nullptr;
+    size_t size = 0;
+
+    ColumnRef() {}
+    ColumnRef(ColumnType type, const void* values, size_t size) : type(type), values(values), size(size) {}
+    ColumnRef(const std::vector<double>& v) : values(v.data()), size(v.size()) {}
+    ColumnRef(const std::vector<double>* v) : ColumnRef(*v) {}
+    ColumnRef(const TypedColumn* column);
+
+    // the values [begin, end), without copying them
+    ColumnRef slice(size_t begin, size_t end) const {
+        return ColumnRef(type, (const char*)values + begin * columnTypeSize(type), end - begin);
+    }
+
+    // call f(const T* values) with the values as an array of their type
+    template <typename F>
+    void visit(F f) const {
+        switch (type) {
+        case COLUMN_FLOAT:
+            f((const float*)values);
+            break;
+        case COLUMN_INT32:
+            f((const int32_t*)values);
+            break;
+        case COLUMN_UINT8:
+            f((const uint8_t*)values);
+            break;
+        default:
+            f((const double*)values);
+            break;
+        }
+    }
+};
+
+class TypedColumn {
+public:
+    explicit TypedColumn(ColumnType type = COLUMN_DOUBLE) : kind(type) {}
+
+    ColumnType type() const { return kind; }
+    size_t size() const { return count; }
+    // bytes taken by the values
+    size_t bytes() const { return count * columnTypeSize(kind); }
+    bool categorical() const { return isCategorical; }
+    // text of every code of a categorical column
+    const std::vector<std::string>& levels() const { return dictionary; }
+
+    ColumnRef ref() const { return ColumnRef(kind, rawData(), count); }
+    operator ColumnRef() const { return ref(); }
+
+    template <typename F>
+    void visit(F f) const { ref().visit(f); }
+
+    // value i as a double (the code of a categorical column)
+    double value(size_t i) const {
+        const void* values = rawData();
+        switch (kind) {
+        case COLUMN_FLOAT:
+            return ((const float*)values)[i];
+        case COLUMN_INT32:
+            return ((const int32_t*)values)[i];
+        case COLUMN_UINT8:
+            return ((const uint8_t*)values)[i];
+        default:
+            return ((const double*)values)[i];
+        }
+    }
+
+    // copy len values from begin to out[0], out[stride], ... as doubles
+    void gather(size_t begin, size_t len, double* out, size_t stride) const {
+        visit([&](const auto* values) {
+            for (size_t i = 0; i < len; i++) {
+                out[i * stride] = (double)values[begin + i];
+            }
+        });
+    }
+
+    // copy the values at rows[0..len) to out[0], out[stride], ... as doubles
+    void gatherRows(const size_t* rows, size_t len, double* out, size_t stride) const {
+        visit([&](const auto* values) {
+            for (size_t i = 0; i < len; i++) {
+                out[i * stride] = (double)values[rows[i]];
+            }
+        });
+    }
+
+    std::vector<double> toDoubles() const {
+        std::vector<double> out(count);
+        gather(0, count, out.data(), 1);
+        return out;
+    }
+
+    // add a value, which must fit the type; not for a column read in place
+    void push(double v) {
+        switch (kind) {
+        case COLUMN_FLOAT:
+            f32.push_back((float)v);
+            break;
+        case COLUMN_INT32:
+            i32.push_back((int32_t)v);
+            break;
+        case COLUMN_UINT8:
+            u8.push_back((uint8_t)v);
+            break;
+        default:
+            f64.push_back(v);
+            break;
+        }
+        count++;
+    }
+
+    // change the type; every value must fit the new one
+    void convert(ColumnType to) {
+        if (to == kind) {
+            return;
+        }
+        TypedColumn converted(to);
+        converted.resize(count);
+        converted.assign(0, ref(), nullptr);
+        converted.isCategorical = isCategorical;
+        converted.dictionary.swap(dictionary);
+        *this = std::move(converted);
+    }
+
+    // make room for n values (new ones are 0); not for a column read in place
+    void resize(size_t n) {
+        switch (kind) {
+        case COLUMN_FLOAT:
+            f32.resize(n);
+            break;
+        case COLUMN_INT32:
+            i32.resize(n);
+            break;
+        case COLUMN_UINT8:
+            u8.resize(n);
+            break;
+        default:
+            f64.resize(n);
+            break;
+        }
+        count = n;
+    }
+
+    /* overwrite the values from offset with the values of source converted to this type
+     * a categorical source's codes are mapped through remap when it is given
+     */
+    void assign(size_t offset, ColumnRef source, const int32_t* remap) {
+        void* to = const_cast<void*>(rawData());
+        source.visit([&](const auto* from) {
+            ColumnRef(kind, to, count).visit([&](const auto* target) {
+                using Target = std::remove_const_t<std::remove_pointer_t<decltype(target)>>;
+                Target* out = const_cast<Target*>(target) + offset;
+                for (size_t i = 0; i < source.size; i++) {
+                    out[i] = remap == nullptr ? (Target)from[i] : (Target)remap[(size_t)from[i]];
+                }
+            });
+        });
+    }
+
+    // the narrowest column that holds every value of v exactly
+    static TypedColumn fromValues(const std::vector<double>& v) {
+        ColumnShape shape;
+        for (double x : v) {
+            shape.add(x);
+        }
+        TypedColumn column(shape.type());
+        column.resize(v.size());
+        column.assign(0, ColumnRef(v), nullptr);
+        return column;
+    }
+
+    /* a copy of values in their own type; with levels it is a categorical column whose values
+     * are codes (of type uint8 or int32) of those levels
+     */
+    static TypedColumn copyOf(ColumnRef values, const std::vector<std::string>* levels = nullptr) {
+        TypedColumn column(values.type);
+        column.resize(values.size);
+        if (levels != nullptr) {
+            column.isCategorical = true;
+            column.dictionary = *levels;
+        }
+        column.assign(0, values, nullptr);
+        return column;
+    }
+
+    /* values read where they are, without copying them; the memory must outlive the column
+     * (and every copy of it), and the column is read-only
+     */
+    static TypedColumn inPlace(ColumnRef values, const std::vector<std::string>* levels = nullptr) {
+        TypedColumn column(values.type);
+        column.external = values.values;
+        column.count = values.size;
+        if (levels != nullptr) {
+            column.isCategorical = true;
+            column.dictionary = *levels;
+        }
+        return column;
+    }
+
+private:
+    ColumnType kind;
+    size_t count = 0;
+    bool isCategorical = false;
+    std::vector<std::string> dictionary;
+    // the values of a column read in place; null when they are in the vectors below
+    const void* external = nullptr;
+    // only the vector of the column's type is used
+    std::vector<double> f64;
+    std::vector<float> f32;
+    std::vector<int32_t> i32;
+    std::vector<uint8_t> u8;
+
+    friend class ColumnBuilder;
+
+    const void* rawData() const {
+        if (external != nullptr) {
+            return external;
+        }
+        switch (kind) {
+        case COLUMN_FLOAT:
+            return f32.data();
+        case COLUMN_INT32:
+            return i32.data();
+        case COLUMN_UINT8:
+            return u8.data();
+        default:
+            return f64.data();
+        }
+    }
+};
+
+inline ColumnRef::ColumnRef(const TypedColumn* column) : ColumnRef(column->ref()) {}
+
+/* the text of a number, used as its level when a column turns out to be categorical
+ * the shortest form of the value, so every way of writing the same number is one level
+ */
+inline std::string numberText(double v) {
+    if (std::isnan(v)) {
+        return "NA";
+    }
+    // -0 may already have been stored as an unsigned 0
+    if (v == 0) {
+        return "0";
+    }
+    char buffer[32];
+    return std::string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), v).ptr);
+}
+
+// builds a TypedColumn one text field at a time, choosing its type as it goes
+class ColumnBuilder {
+public:
+    /* add one field; quotes, spaces and a trailing '\r' around it are ignored
+     * in a categorical column a number gets the level numberText gives it whether it comes
+     * before or after the first text, so the levels do not depend on where a file is cut
+     */
+    void add(const char* begin, const char* end) {
+        double v;
+        bool number = parseField(begin, end, v) || missingField(begin, end, v);
+        if (!column.categorical()) {
+            if (number) {
+                shape.add(v);
+                if (shape.type() != column.type()) {
+                    column.convert(shape.type());
+                }
+                column.push(v);
+                return;
+            }
+            makeCategorical();
+        }
+        addLevel(number ? numberText(v) : trimmed(begin, end));
+    }
+
+    const ColumnShape& numericShape() const { return shape; }
+    const TypedColumn& result() const { return column; }
+    TypedColumn& result() { return column; }
+
+    // turn the numbers read so far into levels, in the order they appear
+    void makeCategorical() {
+        if (column.categorical()) {
+            return;
+        }
+        std::vector<double> numbers = column.toDoubles();
+        column = TypedColumn(COLUMN_UINT8);
+        column.isCategorical = true;
+        for (double v : numbers) {
+            addLevel(numberText(v));
+        }
+    }
+
+    // the code of text, added as a new level if it is new
+    int32_t levelCode(const std::string& text) {
+        auto found = codes.find(text);
+        if (found != codes.end()) {
+            return found->second;
+        }
+        int32_t code = (int32_t)column.dictionary.size();
+        codes.emplace(text, code);
+        column.dictionary.push_back(text);
+        if (column.dictionary.size() > UINT8_LEVELS && column.type() == COLUMN_UINT8) {
+            column.convert(COLUMN_INT32);
+        }
+        return code;
+    }
+
+private:
+    TypedColumn column = TypedColumn(COLUMN_UINT8);
+    ColumnShape shape;
+    std::unordered_map<std::string, int32_t> codes;
+
+    void addLevel(const std::string& text) {
+        column.push(levelCode(text));
+    }
+
+    static std::string trimmed(const char* begin, const char* end) {
+        while (begin < end && (*begin == ' ' || *begin == '"')) {
+            begin++;
+        }
+        while (end > begin && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) {
+            end--;
+        }
+        return std::string(begin, end);
+    }
+
+    // an empty field or NA is a missing number
+    static bool missingField(const char* begin, const char* end, double& value) {
+        std::string text = trimmed(begin, end);
+        value = std::numeric_limits<double>::quiet_NaN();
+        return text.empty() || text == "NA";
+    }
+};
+
+// the columns read from a CSV file, each in its own type
+struct TypedTable {
+    // the first line of the file as it was read
+    std::string headerLine;
+    // names of the columns that were read (skipped columns are not included)
+    std::vector<std::string> header;
+    std::vector<TypedColumn> columns;
+    size_t rows = 0;
+    // what went wrong when reading failed
+    std::string error;
+    // the memory of columns read in place (a mapped cache file), kept alive with the table
+    std::shared_ptr<const void> storage;
+
+    // bytes taken by the values of all the columns
+    size_t bytes() const {
+        size_t total = 0;
+        for (const TypedColumn& column : columns) {
+            total += column.bytes();
+        }
+        return total;
+    }
+};
+
+/* some of the rows of a table without copying them: the rows index[0..n) in that order, or the
+ * rows [first, first + n) if index is null; the table (and index) must outlive the view
+ */
+class TableView {
+public:
+    TableView(const TypedTable& table, const size_t* index, size_t n)
+        : data(&table), rowIndex(index), first(0), n(n) {}
+
+    TableView(const TypedTable& table, const std::vector<size_t>& index) : TableView(table, index.data(), index.size()) {}
+
+    // every row of table
+    explicit TableView(const TypedTable& table) : TableView(range(table, 0, table.rows)) {}
+
+    // the rows [begin, end) of table
+    static TableView range(const TypedTable& table, size_t begin, size_t end) {
+        TableView view(table, nullptr, end - begin);
+        view.first = begin;
+        return view;
+    }
+
+    size_t rows() const { return n; }
+    // row of the table that row r of the view is
+    size_t row(size_t r) const { return rowIndex != nullptr ? rowIndex[r] : first + r; }
+    // the view's row numbers, or null for a range of rows
+    const size_t* index() const { return rowIndex; }
+    const TypedTable& table() const { return *data; }
+
+    /* column c as the view reads it: row r of the view is value index()[r] of it, or value r when
+     * index() is null (the column then starts at the view's first row)
+     */
+    ColumnRef column(size_t c) const {
+        ColumnRef whole = data->columns[c].ref();
+        return rowIndex != nullptr ? whole : whole.slice(first, first + n);
+    }
+
+    // value of column c at row r of the view as a double
+    double value(size_t c, size_t r) const { return data->columns[c].value(row(r)); }
+
+    // copy column c of the view's rows [begin, begin + len) to out[0], out[stride], ... as doubles
+    void gather(size_t c, size_t begin, size_t len, double* out, size_t stride) const {
+        if (rowIndex != nullptr) {
+            data->columns[c].gatherRows(rowIndex + begin, len, out, stride);
+        }
+        else {
+            data->columns[c].gather(first + begin, len, out, stride);
+        }
+    }
+
+    // column c of every row of the view as doubles
+    std::vector<double> values(size_t c) const {
+        std::vector<double> out(n);
+        gather(c, 0, n, out.data(), 1);
+        return out;
+    }
+
+private:
+    const TypedTable* data;
+    const size_t* rowIndex;
+    size_t first;
+    size_t n;
+};
+
+// the narrowest typed columns that hold the values of a table read with readCsv
+inline TypedTable typedTable(const CsvTable& table) {
+    TypedTable typed;
+    typed.headerLine = table.headerLine;
+    typed.header = table.header;
+    typed.rows = table.rows;
+    for (const std::vector<double>& column : table.columns) {
+        typed.columns.push_back(TypedColumn::fromValues(column));
+    }
+    return typed;
+}
+
+/* join the columns read from consecutive byte ranges into columns, in range order
+ * a column is categorical if any range found text in it; otherwise its type comes from the
+ * merged shapes. Every range is converted into place on its own thread
+ */
+inline void joinColumnPieces(std::vector<std::vector<ColumnBuilder>>& pieces, std::vector<TypedColumn>& columns) {
+    size_t chunks = pieces.size();
+    std::vector<std::vector<std::vector<int32_t>>> remaps(columns.size(), std::vector<std::vector<int32_t>>(chunks));
+    std::vector<size_t> offsets(chunks + 1, 0);
+    for (size_t c = 0; c < chunks; c++) {
+        offsets[c + 1] = offsets[c] + pieces[c][0].result().size();
+    }
+
+    for (size_t col = 0; col < columns.size(); col++) {
+        bool categorical = false;
+        ColumnShape shape;
+        for (size_t c = 0; c < chunks; c++) {
+            categorical = categorical || pieces[c][col].result().categorical();
+            shape.merge(pieces[c][col].numericShape());
+        }
+        if (!categorical) {
+            columns[col] = TypedColumn(shape.type());
+        }
+        else {
+            // number the levels in the order they first appear in the file
+            ColumnBuilder levels;
+            levels.makeCategorical();
+            for (size_t c = 0; c < chunks; c++) {
+                pieces[c][col].makeCategorical();
+                for (const std::string& text : pieces[c][col].result().levels()) {
+                    remaps[col][c].push_back(levels.levelCode(text));
+                }
+            }
+            columns[col] = TypedColumn::copyOf(ColumnRef(levels.result().type(), nullptr, 0), &levels.result().levels());
+        }
+        columns[col].resize(offsets[chunks]);
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < chunks; c++) {
+        workers.emplace_back([&, c]() {
+            for (size_t col = 0; col < columns.size(); col++) {
+                const std::vector<int32_t>& remap = remaps[col][c];
+                columns[col].assign(offsets[c], pieces[c][col].result(), columns[col].categorical() ? remap.data() : nullptr);
+                pieces[c][col] = ColumnBuilder();
+            }
+        });
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+/* read the CSV file at path into typed columns, inferring every column's type from its values
+ * skipLeading = number of columns at the start of every row to ignore (for example a row id)
+ * threads = number of threads to parse with; small files are always read on one thread
+ * returns false and sets table.error if the file could not be opened or a row has the wrong number of fields
+ */
+inline bool readTypedCsv(const std::string& path, TypedTable& table, int skipLeading = 0, int threads = 1) {
+    MappedFile file;
+    if (!file.open(path)) {
+        table.error = "Could not open file " + path + ".";
+        return false;
+    }
+
+    const char* end = file.data() + file.size();
+    const char* body = readCsvHeader(file.data(), end, table.headerLine);
+    std::vector<std::string> names = splitHeader(table.headerLine);
+    int numFields = (int)names.size();
+    if (skipLeading >= numFields) {
+        table.error = "File " + path + " has no columns to read";
+        return false;
+    }
+    table.header.assign(names.begin() + skipLeading, names.end());
+    size_t numColumns = names.size() - skipLeading;
+
+    std::vector<const char*> cuts = csvChunkCuts(body, end, threads);
+    size_t chunks = cuts.size() - 1;
+    std::vector<std::vector<ColumnBuilder>> pieces(chunks, std::vector<ColumnBuilder>(numColumns));
+    std::vector<std::string> errors(chunks);
+    std::vector<char> ok(chunks, 1);
+    auto parse = [&](size_t c, size_t firstLine) {
+        ok[c] = scanCsvRange(cuts[c], cuts[c + 1], numFields, skipLeading, firstLine, errors[c],
+            [&](int column, const char* fieldBegin, const char* fieldEnd, size_t) {
+                pieces[c][column].add(fieldBegin, fieldEnd);
+                return true;
+            });
+    };
+
+    if (chunks == 1) {
+        parse(0, 2);
+    }
+    else {
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c < chunks; c++) {
+            workers.emplace_back(parse, c, 0);
+        }
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+    for (size_t c = 0; c < chunks; c++) {
+        if (!ok[c]) {
+            // parse the range again knowing its first line number so the error points at the right line
+            if (chunks > 1) {
+                parse(c, csvLineAt(body, cuts[c]));
+            }
+            table.error = errors[c];
+            return false;
+        }
+    }
+
+    table.columns.assign(numColumns, TypedColumn());
+    if (chunks == 1) {
+        for (size_t col = 0; col < numColumns; col++) {
+            table.columns[col] = std::move(pieces[0][col].result());
+        }
+    }
+    else {
+        joinColumnPieces(pieces, table.columns);
+    }
+    table.rows = table.columns[0].size();
+    return true;
+}
+
+// the stats of a column of any type (the codes of a categorical one)
+inline RunningStats collectStats(const TypedColumn& column, int threads = 1) {
+    RunningStats stats;
+    column.visit([&](const auto* values) { stats = collectStats(values, column.size(), threads); });
+    return stats;
+}
+
+// the stats and co-moment of two equal-length columns of any types
+inline PairStats collectPairStats(const TypedColumn& x, const TypedColumn& y, int threads = 1) {
+    PairStats stats;
+    x.visit([&](const auto* xs) {
+        y.visit([&](const auto* ys) { stats = collectPairStats(xs, ys, std::min(x.size(), y.size()), threads); });
+    });
+    return stats;
+}
+
+#endif